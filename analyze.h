@@ -0,0 +1,175 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of the Havoc chess engine
+Copyright (c) 2020 Minniesoft
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#ifndef ANALYZE_H
+#define ANALYZE_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+#include "types.h"
+#include "position.h"
+#include "threads.h"
+#include "utils.h"
+#include "search.h"
+#include "selfplay.h"
+
+// batch analysis: independent searches over a stream of fen/epd lines, one
+// per worker at a time, each result written as a json line as soon as it is
+// done (so in completion order, id is the 1-based input line number, blank
+// lines counted).  workers keep their own hash table, or share one big one,
+// and always their own pawn and material tables.  tables are not cleared
+// between positions
+namespace analyze {
+
+  struct settings {
+    limits lims;
+    unsigned workers;
+    size_t hash_mb;
+    bool shared;
+    std::string in;   // empty: stdin until a line "end"
+    std::string out;  // empty: stdout
+  };
+
+  // enough to keep position::setup away from garbage
+  inline bool plausible_fen(const std::string& fen) {
+    std::istringstream fields(fen);
+    std::string board, side;
+    if (!(fields >> board >> side)) return false;
+    if (side != "w" && side != "b") return false;
+    if (std::count(board.begin(), board.end(), '/') != 7) return false;
+    if (std::count(board.begin(), board.end(), 'K') != 1 || std::count(board.begin(), board.end(), 'k') != 1) return false;
+    unsigned files = 0;
+    for (const char c : board) {
+      if (c == '/') { if (files != 8) return false; files = 0; }
+      else if (c >= '1' && c <= '8') files += c - '0';
+      else if (std::string("pnbrqkPNBRQK").find(c) != std::string::npos) ++files;
+      else return false;
+    }
+    return files == 8;
+  }
+
+  // searches one line, returns its json line
+  inline std::string analyze_line(const U64& id, const std::string& line, limits lims, position& p, selfplay::game_tables& tables, hash_table * shared) {
+    std::ostringstream o;
+    const std::string fen = util::fen_from_epd(line);
+    if (!plausible_fen(fen)) {
+      o << "{\"id\":" << id << ",\"error\":\"invalid fen\"}";
+      return o.str();
+    }
+
+    std::istringstream fstream(fen);
+    p.setup(fstream);
+    tables.bind(p);
+    if (shared) p.set_hash_table(shared);
+
+    o << "{\"id\":" << id << ",\"fen\":\"" << fen << "\"";
+
+    if (selfplay::legal_moves(p).empty()) {
+      o << ",\"bestmove\":null,\"score\":null,\"pv\":[],\"nodes\":0,\"result\":\""
+	<< (p.in_check() ? "checkmate" : "stalemate") << "\"}";
+      return o.str();
+    }
+
+    p.sigs().reset(lims.ponder);
+    Search::start(p, lims, true);
+
+    o << ",\"bestmove\":\"" << p.bestmove << "\",\"score\":" << p.bestscore << ",\"pv\":[";
+    std::istringstream moves(p.bestline);
+    std::string m;
+    for (bool first = true; moves >> m; first = false) o << (first ? "" : ",") << "\"" << m << "\"";
+    o << "],\"nodes\":" << p.nodes() << ",\"time_ms\":" << static_cast<U64>(p.elapsed_ms) << "}";
+    return o.str();
+  }
+
+  inline void run(const settings& s) {
+    std::ifstream file;
+    if (!s.in.empty()) {
+      file.open(s.in);
+      if (!file.is_open()) {
+        std::cout << "info string cannot open " << s.in << std::endl;
+        return;
+      }
+    }
+    std::istream& in = (s.in.empty() ? std::cin : file);
+
+    std::ofstream out_file;
+    if (!s.out.empty()) out_file.open(s.out);
+    std::ostream& out = (s.out.empty() ? std::cout : out_file);
+
+    const unsigned slots = std::max(1u, s.workers);
+    std::unique_ptr<hash_table> shared;
+    if (s.shared) shared = util::make_unique<hash_table>(s.hash_mb);
+
+    std::mutex in_mtx, out_mtx;
+    U64 lines_read = 0;
+    bool done = false;
+    std::atomic<U64> analyzed{ 0 };
+    util::clock timer;
+    timer.start();
+
+    Threadpool pool(slots);
+    for (unsigned slot = 0; slot < slots; ++slot) {
+      pool.enqueue([&]() {
+	selfplay::game_tables tables(s.shared ? 1 : s.hash_mb);
+	position p;
+
+	while (true) {
+	  std::string line;
+	  U64 id = 0;
+	  {
+	    std::unique_lock<std::mutex> lock(in_mtx);
+	    while (!done) {
+	      if (!std::getline(in, line) || line == "end") { done = true; break; }
+	      ++lines_read;
+	      if (line.find_first_not_of(" \t\r") != std::string::npos) break;
+	    }
+	    if (done) return;
+	    id = lines_read;
+	  }
+
+	  const std::string result = analyze_line(id, line, s.lims, p, tables, shared.get());
+	  ++analyzed;
+
+	  std::unique_lock<std::mutex> lock(out_mtx);
+	  out << result << std::endl;
+	}
+      });
+    }
+    pool.wait_finished();
+    timer.stop();
+
+    std::cout << "info string analyzed " << analyzed << " positions in " << static_cast<U64>(timer.ms())
+	      << " ms (" << static_cast<U64>(analyzed / std::max(timer.ms(), 1e-3) * 1000.0) << " per second)" << std::endl;
+  }
+}
+
+#endif
@@ -63,7 +63,7 @@ struct scores {
 
 namespace pbil_score {
 
-  size_t iteration = 0;
+  std::atomic<size_t> iteration{ 0 };
   double best_score = std::numeric_limits<double>::max();
   parameters engine_params;
   std::vector<float> tuneable_params;
@@ -93,8 +93,9 @@ class Perft {
   inline void divide(position& p, int d);
   inline void gen(position& p, U64& times);
   static inline double pbil_search(position& p, const int& depth, scores& S, bool silent);
-  inline void auto_tune() const;
-  inline void bench(const int& depth, bool silent) const;
+  inline void auto_tune(const std::string& epd_file) const;
+  inline void bench(const int& depth, unsigned threads, size_t hash_mb, const std::string& epd_file) const;
+  inline void scalebench(unsigned max_threads, int depth, unsigned movetime, size_t hash_mb, bool json) const;
 };
 
 
@@ -176,23 +177,23 @@ void Perft::divide(position& p, int d) {
   gen_timer.start();
   mvs.generate<pseudo_legal, pieces>();
   gen_timer.stop();
-  gen_times.push_back(gen_timer.ms()*1000);
+  gen_times.push_back(gen_timer.ms()*1e6);
   
   for (int i = 0; i < mvs.size(); ++i) {
 
     legal_timer.start();
     if (!p.is_legal(mvs[i])) {
       legal_timer.stop();
-      legal_times.push_back(legal_timer.ms()*1000);
+      legal_times.push_back(legal_timer.ms()*1e6);
       continue;
     }
     legal_timer.stop();
-    legal_times.push_back(legal_timer.ms()*1000);
+    legal_times.push_back(legal_timer.ms()*1e6);
 	  
     dom_timer.start();
     p.do_move(mvs[i]);
     dom_timer.stop();
-    do_mv_times.push_back(1000*dom_timer.ms());
+    do_mv_times.push_back(1e6*dom_timer.ms());
 
     int n = d > 1 ? search(p, d - 1) : 1;
     total += n;
@@ -200,7 +201,7 @@ void Perft::divide(position& p, int d) {
     dom_timer.start();
     p.undo_move(mvs[i]);
     dom_timer.stop();
-    undo_mv_times.push_back(1000*dom_timer.ms());    
+    undo_mv_times.push_back(1e6*dom_timer.ms());    
 
     std::cout << SanSquares[mvs[i].f]
 	      << SanSquares[mvs[i].t]
@@ -313,11 +314,20 @@ inline void update_options_file(const position& p) {
   //opts->save_param_file(std::string(""));
 }
 
+// scores one population sample.  runs concurrently with the other samples, so
+// the position, parameter copy, hash tables and stop signal are all local
 inline double pbil_residual(const std::vector<int>& new_bits) {
 
-  ++pbil_score::iteration;
+  const size_t sample = ++pbil_score::iteration;
 
   position p;
+  hash_table tt(16);
+  pawn_table pt(1);
+  material_table mt(1);
+  signals sig{};
+  p.set_hash_table(&tt);
+  p.set_eval_tables(&pt, &mt);
+  p.set_signals(&sig);
 
   {
     std::unique_lock<std::mutex> lock(mtx);
@@ -379,10 +389,6 @@ inline double pbil_residual(const std::vector<int>& new_bits) {
   p.params.king_safe_sqs[5] = new_params[28];
   p.params.king_safe_sqs[6] = new_params[29];
   p.params.king_safe_sqs[7] = new_params[30];
-  
-  ttable.clear();
-  mtable.clear();
-  ptable.clear();
 
   scores S;
   Perft perft;
@@ -391,9 +397,10 @@ inline double pbil_residual(const std::vector<int>& new_bits) {
 
 
   // log best param set thus far (under lock)
-  if (minimized_score < pbil_score::best_score) {
-    std::unique_lock<std::mutex> lock(mtx);
+  std::unique_lock<std::mutex> lock(mtx);
+  std::cout << "sample: " << sample << " score: " << minimized_score << " best score: " << pbil_score::best_score << std::endl;
 
+  if (minimized_score < pbil_score::best_score) {
     pbil_score::best_score = minimized_score;
 
     update_options_file(p);
@@ -404,7 +411,7 @@ inline double pbil_residual(const std::vector<int>& new_bits) {
 }
 
 
-inline void Perft::auto_tune() const
+inline void Perft::auto_tune(const std::string& epd_file) const
 {
 
   pbil_score::engine_params = eval::Parameters;
@@ -444,7 +451,7 @@ inline void Perft::auto_tune() const
   };
  
 
-  pbil_score::E = util::make_unique<epd>("A:\\code\\chess\\sbchess\\tuning\\epd\\mini-test.txt");
+  pbil_score::E = util::make_unique<epd>(epd_file);
 
 
 
@@ -479,15 +486,12 @@ inline double Perft::pbil_search(position& p, const int& depth, scores& S, bool
 
   S.correct = 0;
   S.total = positions.size();
-  size_t counter = 1;
   for (const epd_entry& e : positions) {
 
-    std::cout << "iteration: " << pbil_score::iteration << " pos: " << counter << "/" << positions.size() << " best score: " << pbil_score::best_score << "\r" << std::flush;
     std::istringstream fen(e.pos);
-    ++counter;
-
     p.setup(fen);
 
+    p.sigs().reset(lims.ponder);
     Search::start(p, lims, silent);
     
     S.correct += (p.bestmove == e.bestmove);
@@ -519,80 +523,269 @@ inline double Perft::pbil_search(position& p, const int& depth, scores& S, bool
   return minimized_score;
 }
 
-inline void Perft::bench(const int& depth, bool silent) const
+// fixed bench set: openings, middlegames with both castling states, pawn and
+// piece endings.  the total node count over these at a given depth is the
+// build's functional signature, so only ever append to this list
+namespace bench_set {
+  const char * const positions[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+    "rnbqkb1r/pp1ppppp/5n2/2p5/2P5/2N5/PP1PPPPP/R1BQKBNR w KQkq - 2 3",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+    "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+    "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+    "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+    "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+    "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+    "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+    "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+    "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+    "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+    "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+    "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+    "r3k2r/3nnpbp/q2pp1p1/p7/Pp1PPPP1/4BNN1/1P5P/R2Q1RK1 w kq - 0 16",
+    "4rrk1/1p1nq3/p7/2p1P1pp/3P2bp/3Q1Bn1/PPPB4/1K2R1NR w - - 40 21",
+    "5rk1/q6p/2p3bR/1pPp1rP1/1P1Pp3/P3B1Q1/1K3P2/R7 w - - 93 90",
+    "3Qb1k1/1r2ppb1/pN1n2q1/Pp1Pp1Pr/4P2p/4BP2/4B1R1/1R5K b - - 11 40",
+    "4k3/3q1r2/1N2r1b1/3ppN2/2nPP3/1B1R2n1/2R1Q3/3K4 w - - 5 1",
+    "6k1/3b3r/1p1p4/p1n2p2/1PPNpP1q/P3Q1p1/1R1RB1P1/5K2 b - - 0 1",
+    "r2r1n2/pp2bk2/2p1p2p/3q4/3PN1QP/2P3R1/P4PP1/5RK1 w - - 0 1",
+    "1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w - - 0 1",
+    "6k1/4pp1p/3p2p1/P1pPb3/R7/1r2P1PP/3B1P2/6K1 w - - 0 1",
+    "6k1/6p1/P6p/r1N5/5p2/7P/1b3PP1/4R1K1 w - - 0 1",
+    "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - - 0 1",
+    "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+    "8/R7/2q5/8/6k1/8/1P5p/K6R w - - 0 124",
+    "2K5/p7/7P/5pR1/8/5k2/r7/8 w - - 0 1",
+    "8/8/1P6/5pr1/8/4R3/7k/2K5 w - - 0 1",
+    "8/2p4P/8/kr6/6R1/8/8/1K6 w - - 0 1",
+    "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - - 0 1",
+    "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - - 0 1",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+    "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+    "8/3p4/p1bk3p/Pp6/1Kp1PpPp/2P2P1P/2P5/5B2 b - - 0 1",
+    "8/3p3B/5p2/5P2/p7/PP5b/k7/6K1 w - - 0 1",
+    "8/8/3P3k/8/1p6/8/1P6/1K3n2 b - - 0 1",
+    "8/8/8/8/5kp1/P7/8/1K1N4 w - - 0 1",
+    "8/8/8/5N2/8/p7/8/2NK3k w - - 0 1",
+    "8/3k4/8/8/8/4B3/4KB2/2B5 w - - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+    "8/2p5/8/2kPKp1p/2p4P/2P5/3P4/8 w - - 0 1",
+    "8/1p3pp1/7p/5P1P/2k3P1/8/2K2P2/8 w - - 0 1",
+    "8/k7/3p4/p2P1p2/P2P1P2/8/8/K7 w - - 0 1"
+  };
+
+  // fen or epd lines, see util::fen_from_epd
+  inline std::vector<std::string> load(const std::string& filename) {
+    std::vector<std::string> fens;
+    std::ifstream in(filename);
+    std::string line;
+    while (std::getline(in, line)) {
+      const std::string fen = util::fen_from_epd(line);
+      if (!fen.empty()) fens.push_back(fen);
+    }
+    return fens;
+  }
+}
+
+// bench [depth] [threads] [hash mb] [epd file]
+// searches every position to a fixed depth from empty tables and history.  on
+// one thread the total node count is reproducible for a given build and set,
+// nps is the number to compare between builds on the same machine
+inline void Perft::bench(const int& depth, unsigned threads, size_t hash_mb, const std::string& epd_file) const
 {
+  std::vector<std::string> fens;
+  if (!epd_file.empty()) {
+    fens = bench_set::load(epd_file);
+    if (fens.empty()) {
+      std::cout << "no positions in " << epd_file << std::endl;
+      return;
+    }
+  }
+  else fens.assign(std::begin(bench_set::positions), std::end(bench_set::positions));
 
-  pbil_score::E = util::make_unique<epd>("A:\\code\\chess\\sbchess\\tuning\\epd\\mini-test.txt");
-  std::vector<epd_entry> positions = pbil_score::E->get_positions();
-  std::vector<std::string> csv_data;
+  hash_table tt(hash_mb);
+  pawn_table pt(1);
+  material_table mt(1);
+  signals sig{};
 
   limits lims{};
   memset(&lims, 0, sizeof(limits));
   lims.depth = depth;
+  lims.threads = threads;
 
   position p;
-  scores S;
-
-  S.correct = 0;
-  S.total = positions.size();
-  size_t counter = 1;
-
-  for (const epd_entry& e : positions) {
-
-    std::cout << "test pos: " << counter << "/" << positions.size() << " correct: " << S.correct << "/" << S.total << "\r" << std::flush;
-    std::istringstream fen(e.pos);
-    ++counter;
+  U64 total_nodes = 0;
+  double total_ms = 0;
 
-    ttable.clear();
-    mtable.clear();
-    ptable.clear();
+  for (size_t i = 0; i < fens.size(); ++i) {
+    tt.clear();
+    pt.clear();
+    mt.clear();
 
+    std::istringstream fen(fens[i]);
     p.setup(fen);
+    p.set_hash_table(&tt);
+    p.set_eval_tables(&pt, &mt);
+    p.set_signals(&sig);
 
-    Search::start(p, lims, silent);
+    p.sigs().reset(lims.ponder);
+    Search::start(p, lims, true);
 
+    total_nodes += p.nodes();
+    total_ms += p.elapsed_ms;
 
-    S.correct += (p.bestmove == e.bestmove);
-    S.times_ms.push_back(p.elapsed_ms);
-    S.nodes.push_back(p.nodes());
-    S.qnodes.push_back(p.qnodes());
+    std::cout << "position " << std::setw(3) << (i + 1) << "/" << fens.size()
+	      << "  " << std::setw(6) << p.bestmove
+	      << std::setw(12) << p.nodes() << " nodes  "
+	      << fens[i] << std::endl;
   }
 
-  // avg nps
-  double avg_nodes = 0;
-  double avg_qnodes = 0;
-  double avg_time_ms = 0;
-  double avg_nps = 0;
+  std::cout << "===========================" << std::endl;
+  std::cout << "depth           : " << depth << std::endl;
+  std::cout << "threads         : " << std::max(threads, 1u) << std::endl;
+  std::cout << "hash (mb)       : " << hash_mb << std::endl;
+  std::cout << "total time (ms) : " << static_cast<U64>(total_ms) << std::endl;
+  std::cout << "nodes searched  : " << total_nodes << std::endl;
+  std::cout << "nodes/second    : " << static_cast<U64>(total_nodes / std::max(total_ms, 1e-3) * 1000.0) << std::endl;
+}
 
-  for (auto& n : S.nodes) { avg_nodes += n; }
-  for (auto& qn : S.qnodes) { avg_qnodes += qn; }
-  avg_nodes /= (S.nodes.size());
-  avg_qnodes /= (S.qnodes.size());
+// scalebench [max threads] [depth] [movetime ms] [hash mb] [json]
+// runs the bench positions at 1, 2, 4 .. max threads, once to a fixed depth
+// and once for a fixed time.  speedups are against one thread: nps from the
+// timed searches, time to depth from the fixed depth ones.  imbalance is the
+// busiest thread's nodes over the mean, less one, averaged over positions
+inline void Perft::scalebench(unsigned max_threads, int depth, unsigned movetime, size_t hash_mb, bool json) const
+{
+  struct scale_result {
+    unsigned threads;
+    U64 nodes;        // timed searches
+    double time_ms;
+    double ttd_ms;    // fixed depth searches
+    U64 tt_probes;
+    U64 tt_hits;
+    double imbalance;
+  };
 
-  for (auto& t : S.times_ms) { avg_time_ms += t; }
-  avg_time_ms /= S.times_ms.size();
-  avg_nps = (avg_nodes + avg_qnodes) / avg_time_ms * 1000.0f;
+  std::vector<unsigned> counts;
+  for (unsigned t = 1; t < max_threads; t *= 2) counts.push_back(t);
+  counts.push_back(max_threads);
 
-  // convert to Mega nodes / sec
-  avg_nps /= 1e6;
-  S.acc_score = S.correct / static_cast<float>(S.total);
+  const std::vector<std::string> fens(std::begin(bench_set::positions), std::end(bench_set::positions));
+
+  hash_table tt(hash_mb);
+  pawn_table pt(1);
+  material_table mt(1);
+  signals sig{};
+  position p;
 
+  auto run = [&](const std::string& f, limits& lims) {
+    tt.clear();
+    pt.clear();
+    mt.clear();
+    std::istringstream fen(f);
+    p.setup(fen);
+    p.set_hash_table(&tt);
+    p.set_eval_tables(&pt, &mt);
+    p.set_signals(&sig);
+    p.sigs().reset(lims.ponder);
+    Search::start(p, lims, true);
+  };
 
-  std::ofstream result_csv("mini-test-result.csv", std::ios_base::app);
+  std::vector<scale_result> results;
+
+  for (const unsigned t : counts) {
+    scale_result r{};
+    r.threads = t;
+
+    for (const std::string& f : fens) {
+      limits lims{};
+      memset(&lims, 0, sizeof(limits));
+      lims.threads = t;
+
+      lims.depth = depth;
+      run(f, lims);
+      r.ttd_ms += p.elapsed_ms;
+
+      lims.depth = 0;
+      lims.movetime = movetime;
+      run(f, lims);
+      r.nodes += p.nodes();
+      r.time_ms += p.elapsed_ms;
+      r.tt_probes += Search::last_stats.tt_probes;
+      r.tt_hits += Search::last_stats.tt_hits;
+
+      const std::vector<U64>& per_thread = Search::last_thread_nodes;
+      if (!per_thread.empty()) {
+        const double mean = static_cast<double>(p.nodes()) / per_thread.size();
+        const U64 busiest = *std::max_element(per_thread.begin(), per_thread.end());
+        r.imbalance += (mean > 0 ? busiest / mean - 1.0 : 0.0) / fens.size();
+      }
+    }
+    results.push_back(r);
 
-  result_csv << "\n";
-  result_csv << "depth, acc, corr, total, avg ms, avg nodes, avg qnodes, avg MNPS\n";
-  result_csv <<
-    depth << "," <<
-    S.acc_score << "," <<
-    S.correct << "," <<
-    S.total << "," <<
-    avg_time_ms << "," <<
-    avg_nodes << "," <<
-    avg_qnodes << "," <<
-    avg_nps << "\n";
+    if (!json) std::cout << "threads " << t << " done" << std::endl;
+  }
+
+  auto nps = [](const scale_result& r) { return r.nodes / std::max(r.time_ms, 1e-3) * 1000.0; };
+  const scale_result& base = results[0];
+
+  if (json) {
+    std::ostringstream o;
+    o << std::setprecision(4);
+    o << "{\"depth\":" << depth << ",\"movetime_ms\":" << movetime << ",\"hash_mb\":" << hash_mb
+      << ",\"positions\":" << fens.size() << ",\"results\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+      const scale_result& r = results[i];
+      o << (i ? "," : "") << "{\"threads\":" << r.threads
+	<< ",\"nps\":" << static_cast<U64>(nps(r))
+	<< ",\"nps_speedup\":" << nps(r) / std::max(nps(base), 1.0)
+	<< ",\"ttd_ms\":" << r.ttd_ms
+	<< ",\"ttd_speedup\":" << base.ttd_ms / std::max(r.ttd_ms, 1e-3)
+	<< ",\"tt_hit_rate\":";
+#ifdef SEARCH_STATS
+      o << search_stats::rate(r.tt_hits, r.tt_probes);
+#else
+      o << "null";
+#endif
+      o << ",\"imbalance\":" << r.imbalance << "}";
+    }
+    o << "]}";
+    std::cout << o.str() << std::endl;
+    return;
+  }
 
-  result_csv.close();
+  std::cout << "===========================" << std::endl;
+  std::cout << "depth " << depth << ", movetime " << movetime << " ms, hash " << hash_mb
+	    << " mb, " << fens.size() << " positions" << std::endl;
+  std::cout << std::setw(8) << "threads" << std::setw(12) << "nps" << std::setw(9) << "nps x"
+	    << std::setw(12) << "ttd ms" << std::setw(9) << "ttd x"
+	    << std::setw(9) << "tt hit" << std::setw(11) << "imbalance" << std::endl;
+  for (const scale_result& r : results) {
+    std::cout << std::fixed << std::setprecision(2)
+	      << std::setw(8) << r.threads
+	      << std::setw(12) << static_cast<U64>(nps(r))
+	      << std::setw(9) << nps(r) / std::max(nps(base), 1.0)
+	      << std::setw(12) << static_cast<U64>(r.ttd_ms)
+	      << std::setw(9) << base.ttd_ms / std::max(r.ttd_ms, 1e-3);
+#ifdef SEARCH_STATS
+    std::cout << std::setw(9) << search_stats::rate(r.tt_hits, r.tt_probes);
+#else
+    std::cout << std::setw(9) << "-";
+#endif
+    std::cout << std::setw(11) << r.imbalance << std::endl;
+  }
+  std::cout.unsetf(std::ios_base::floatfield);
+  std::cout << std::setprecision(6);
+#ifndef SEARCH_STATS
+  std::cout << "(tt hit rate needs a SEARCH_STATS build)" << std::endl;
+#endif
 }
 
+
 #endif
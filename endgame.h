@@ -202,12 +202,13 @@ namespace eval {
     int row = util::row(f);
     int col = util::col(f);
 
-    Square frs = p.squares_of<c, rook>()[0];
+    U64 frooks = p.get_pieces<c, rook>();
+    auto frs = static_cast<Square>(bits::lsb(frooks));
     int col_fr = util::col(frs);
     int row_fr = util::row(frs);
 
-    Square ers = (c == white ? p.squares_of<black, rook>()[0] :
-      p.squares_of<white, rook>()[0]);
+    U64 erooks = (c == white ? p.get_pieces<black, rook>() : p.get_pieces<white, rook>());
+    auto ers = static_cast<Square>(bits::lsb(erooks));
     int col_er = util::col(ers);
     int row_er = util::row(ers);
 
@@ -87,18 +87,14 @@ namespace {
     return 0.0f + 2.22f * log(n + 1); // max of ~20
   }
 
-  float do_eval(const position& p, const float& lazy_margin) {
-
-
-    float score = 0;
-    einfo ei = {};
+  void init_info(const position& p, einfo& ei) {
     memset(&ei, 0, sizeof(einfo));
 
     {
       // hash table data
       //std::unique_lock<std::mutex> lock(eval::mtx);
-      ei.pe = ptable.fetch(p);
-      ei.me = mtable.fetch(p);
+      ei.pe = p.pawns().fetch(p);
+      ei.me = p.material().fetch(p);
     }
 
     ei.all_pieces = p.all_pieces();
@@ -122,7 +118,13 @@ namespace {
     // pawn holes
     ei.pawn_holes[white] = (ei.pe->backward[white] != 0ULL ? ei.pe->backward[white] << 8 : 0ULL);
     ei.pawn_holes[black] = (ei.pe->backward[black] != 0ULL ? ei.pe->backward[black] >> 8 : 0ULL);
+  }
+
+  float do_eval(const position& p, const float& lazy_margin) {
 
+    float score = 0;
+    einfo ei = {};
+    init_info(p, ei);
 
     // init score    
     score += ei.pe->score;
@@ -204,14 +206,15 @@ namespace {
 
   template<Color c> float eval_knights(const position& p, einfo& ei) {
     float score = 0;
-    Square * knights = p.squares_of<c, knight>();
+    U64 knights = p.get_pieces<c, knight>();
     auto them = static_cast<Color>(c ^ 1);
     U64 enemies = ei.pieces[them];
     U64 pawn_targets = ei.weak_pawns[them];
     U64 equeen_sq = ei.queen_sqs[them];
     int ks = p.king_square(c);
 
-    for (Square s = *knights; s != no_square; s = *++knights) {
+    while (knights) {
+      const auto s = static_cast<Square>(bits::pop_lsb(knights));
       score += p.params.sq_score_scaling[knight] * square_score<c>(knight, s);
 
       // mobility
@@ -282,7 +285,7 @@ namespace {
 
   template<Color c> float eval_bishops(const position& p, einfo& ei) {
     float score = 0;
-    Square * bishops = p.squares_of<c, bishop>();
+    U64 bishops = p.get_pieces<c, bishop>();
     auto them = static_cast<Color>(c ^ 1);
     U64 enemies = ei.pieces[them];
     U64 pawn_targets = ei.weak_pawns[them];
@@ -299,7 +302,8 @@ namespace {
       p.get_pieces<white, queen>() | p.get_pieces<white, rook>() | p.get_pieces<white, king>());
     int ks = p.king_square(c);
 
-    for (Square s = *bishops; s != no_square; s = *++bishops) {
+    while (bishops) {
+      const auto s = static_cast<Square>(bits::pop_lsb(bishops));
       score += p.params.sq_score_scaling[bishop] * square_score<c>(bishop, s);
 
       if (bitboards::squares[s] & bitboards::colored_sqs[white]) light_sq = true;
@@ -423,7 +427,7 @@ namespace {
 
   template<Color c> float eval_rooks(const position& p, einfo& ei) {
     float score = 0;
-    Square * rooks = p.squares_of<c, rook>();
+    U64 rooks = p.get_pieces<c, rook>();
     auto them = static_cast<Color>(c ^ 1);
     U64 enemies = ei.pieces[them];
     U64 pawn_targets = ei.weak_pawns[them];
@@ -433,7 +437,8 @@ namespace {
       p.get_pieces<black, queen>() | p.get_pieces<black, king>() :
       p.get_pieces<white, queen>() | p.get_pieces<white, king>());
 
-    for (Square s = *rooks; s != no_square; s = *++rooks) {
+    while (rooks) {
+      const auto s = static_cast<Square>(bits::pop_lsb(rooks));
       score += p.params.sq_score_scaling[rook] * square_score<c>(rook, s);
 
       Squares.push_back(s);
@@ -542,12 +547,13 @@ namespace {
 
   template<Color c> float eval_queens(const position& p, einfo& ei) {
     float score = 0;
-    Square * queens = p.squares_of<c, queen>();
+    U64 queens = p.get_pieces<c, queen>();
     auto them = static_cast<Color>(c ^ 1);
     U64 enemies = ei.pieces[them];
     U64 pawn_targets = ei.weak_pawns[them];
 
-    for (Square s = *queens; s != no_square; s = *++queens) {
+    while (queens) {
+      const auto s = static_cast<Square>(bits::pop_lsb(queens));
       score += p.params.sq_score_scaling[queen] * square_score<c>(queen, s);
 
       // mobility      
@@ -596,11 +602,12 @@ namespace {
 
   template<Color c> float eval_king(const position& p, einfo& ei) {
     float score = 0;
-    Square * kings = p.squares_of<c, king>();
+    U64 kings = p.get_pieces<c, king>();
     auto them = static_cast<Color>(c ^ 1);
     float attacker_score = 0.0f;
 
-    for (Square s = *kings; s != no_square; s = *++kings) {
+    while (kings) {
+      const auto s = static_cast<Square>(bits::pop_lsb(kings));
 
       if (!ei.me->is_endgame()) {
         score += p.params.sq_score_scaling[king] * square_score<c>(king, s);
@@ -958,4 +965,36 @@ namespace {
 
 namespace eval {
   float evaluate(const position& p, const float& lazy_margin) { return do_eval(p, lazy_margin); }
+
+  const char * const term_names[terms] = {
+    "color", "knights", "bishops", "rooks", "queens", "king",
+    "passed pawns", "space", "center", "pawn levers"
+  };
+
+  namespace {
+    float run_term(const position& p, einfo& ei, const Term& t) {
+      switch (t) {
+        case term_color: return eval_color<white>(p, ei) - eval_color<black>(p, ei);
+        case term_knights: return eval_knights<white>(p, ei) - eval_knights<black>(p, ei);
+        case term_bishops: return eval_bishops<white>(p, ei) - eval_bishops<black>(p, ei);
+        case term_rooks: return eval_rooks<white>(p, ei) - eval_rooks<black>(p, ei);
+        case term_queens: return eval_queens<white>(p, ei) - eval_queens<black>(p, ei);
+        case term_king: return eval_king<white>(p, ei) - eval_king<black>(p, ei);
+        case term_passed_pawns: return eval_passed_pawns<white>(p, ei) - eval_passed_pawns<black>(p, ei);
+        case term_space: return eval_space<white>(p, ei) - eval_space<black>(p, ei);
+        case term_center: return eval_center<white>(p, ei) - eval_center<black>(p, ei);
+        case term_pawn_levers: return eval_pawn_levers<white>(p, ei) - eval_pawn_levers<black>(p, ei);
+        default: return 0;
+      }
+    }
+  }
+
+  // the terms run in do_eval order, so the king term sees the attacker counts
+  // left by the piece terms
+  void prepare_terms(const position& p, einfo& ei) {
+    init_info(p, ei);
+    for (unsigned t = 0; t < terms; ++t) run_term(p, ei, static_cast<Term>(t));
+  }
+
+  float evaluate_term(const position& p, einfo ei, const Term& t) { return run_term(p, ei, t); }
 }
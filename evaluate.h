@@ -61,6 +61,16 @@ namespace eval {
 
   float evaluate(const position& p, const float& lazy_margin);
 
+  // the positional terms of a full evaluation, white minus black, one at a
+  // time.  for timing: prepare once, then each call works on its own copy
+  enum Term {
+    term_color, term_knights, term_bishops, term_rooks, term_queens, term_king,
+    term_passed_pawns, term_space, term_center, term_pawn_levers, terms
+  };
+  extern const char * const term_names[terms];
+
+  void prepare_terms(const position& p, einfo& ei);
+  float evaluate_term(const position& p, einfo ei, const Term& t);
 }
 
 namespace eval {
@@ -20,8 +20,10 @@ THE SOFTWARE.
 -----------------------------------------------------------------------------
 */
 #include "hashtable.h"
+#include "trace.h"
 #include <xmmintrin.h>
 #include <mmintrin.h>
+#include <limits>
 
 hash_table ttable;
 
@@ -31,8 +33,17 @@ inline size_t pow2(const size_t x) {
 
 
 
-hash_table::hash_table() : sz_mb(0), cluster_count(0) {
-  sz_mb = 3 * 128 * 1024;
+hash_table::hash_table() : sz_mb(3 * 128 * 1024), cluster_count(0) {
+  init();
+}
+
+
+hash_table::hash_table(const size_t& mb) : sz_mb(mb * 1024), cluster_count(0) {
+  init();
+}
+
+
+void hash_table::init() {
   cluster_count = 1024 * sz_mb / sizeof(hash_cluster);
   cluster_count = pow2(cluster_count);
   if (cluster_count < 1024) cluster_count = 1024;
@@ -44,6 +55,7 @@ hash_table::hash_table() : sz_mb(0), cluster_count(0) {
 
 void hash_table::clear() const
 {
+  trace::scope clearing("tt clear", "mb", static_cast<int>(sz_mb / 1024));
   memset(entries.get(), 0, sizeof(hash_cluster)*cluster_count);
 }
 
@@ -77,30 +89,33 @@ void hash_table::save(const U64& key,
   const Move& m,
   const int16& score, const bool& pv_node) const
 {
-
-  entry*replace;
-
-  entry* e = replace = first_entry(key);
-
-  for (unsigned i = 0; i < cluster_size; ++i, ++e) {
-
-    // empty entry or hash collision
-    if (e->empty()) {
+  entry * const first = first_entry(key);
+  entry * replace = nullptr;
+
+  // an entry of this key is updated in place, never duplicated
+  for (entry * e = first; e != first + cluster_size; ++e) {
+    if (!e->empty() && (e->pkey ^ e->dkey) == key) {
+      // a qsearch (depth 0) result does not overwrite a deeper result of this search
+      if (depth == 0 && e->age() == age && e->depth() > 0) return;
       replace = e;
       break;
     }
+  }
 
-    // collision handling (depth, age and pv node)
-    if (((e->pkey) ^ (e->dkey)) == key) {
-	    if (age - e->age() > 1) {
-		    replace = e;
-	    }
-	    else if (e->depth() - depth > 0 && pv_node) {
-		    replace = e;
-	    }
+  // otherwise an empty entry, else the shallowest, older searches first
+  if (!replace) {
+    int worst = std::numeric_limits<int>::max();
+    for (entry * e = first; e != first + cluster_size; ++e) {
+      if (e->empty()) { replace = e; break; }
+      const int value = e->depth() - 8 * static_cast<U8>(age - e->age());
+      if (value < worst) { worst = value; replace = e; }
     }
+    if (depth == 0 && !replace->empty() && replace->age() == age && replace->depth() > 0) return;
   }
 
-  replace->encode(depth, bound, age, m, score);
+  // keep the stored move when the new result has none (stand pat)
+  const Move move = (m == Move{} && !replace->empty() && (replace->pkey ^ replace->dkey) == key) ? replace->move() : m;
+
+  replace->encode(depth, bound, age, move, score);
   replace->pkey = key ^ replace->dkey;
 }
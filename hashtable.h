@@ -24,6 +24,7 @@ THE SOFTWARE.
 #define HASHTABLE_H
 
 #include <memory>
+#include <atomic>
 
 #include "types.h"
 #include "move.h"
@@ -54,9 +55,11 @@ struct entry {
     dkey |= (static_cast<U64>(age) << 55); // 9 bits .. 
   }
 
-  U8 depth() const { return static_cast<U8>((dkey & 0xFF0000000) >> 30); }
-  U8 bound() const { return static_cast<U8>((dkey & 0xF000000) >> 26); }
-  U8 age() const { return static_cast<U8>(dkey & 0x7F80000000000000 >> 55); }
+  // depth is stored + 1, so an entry saved at depth 0 differs from an empty one
+  U8 depth() const { return static_cast<U8>(((dkey >> 30) & 0xFF) - 1); }
+  U8 bound() const { return static_cast<U8>((dkey >> 26) & 0xF); }
+  U8 age() const { return static_cast<U8>((dkey >> 55) & 0xFF); }
+  Move move() const { Move m; m.set(dkey & 0xFF, (dkey >> 8) & 0xFF, static_cast<Movetype>((dkey >> 16) & 0xFF)); return m; }
 };
 
 
@@ -76,12 +79,11 @@ struct hash_data {
     U8 f = static_cast<U8>(dkey & 0xFF);
     U8 t = static_cast<U8>((dkey & 0xFF00) >> 8);
     auto type = static_cast<Movetype>((dkey & 0xFF0000) >> 16);
-    bound = static_cast<U8>((dkey & 0xF000000) >> 26);
-    depth = static_cast<U8>((dkey & 0xFF0000000) >> 30);
-    score = static_cast<int16>((dkey & 0xFFFF000000000) >> 38);    
-    int sign = static_cast<int>(dkey & (1ULL << 54));
-    score = (sign == 1 ? -score : score);
-    age = static_cast<U8>(dkey & 0x7F80000000000000 >> 55);
+    bound = static_cast<U8>((dkey >> 26) & 0xF);
+    depth = static_cast<char>(((dkey >> 30) & 0xFF) - 1);
+    score = static_cast<int16>((dkey >> 38) & 0xFFFF);
+    if (dkey & (1ULL << 54)) score = -score;
+    age = static_cast<U8>((dkey >> 55) & 0xFF);
 
     move.set(f, t, type);
   }  
@@ -100,9 +102,13 @@ class hash_table {
 	size_t sz_mb;
   size_t cluster_count;
   std::unique_ptr<hash_cluster[]> entries;
+  mutable std::atomic<U8> generation{ 0 };
+
+  void init();
 
  public:
   hash_table();
+  explicit hash_table(const size_t& mb);
   hash_table(const hash_table& o) = delete;
   hash_table(const hash_table&& o) = delete;
   ~hash_table() = default;
@@ -119,6 +125,10 @@ class hash_table {
   bool fetch(const U64& key, hash_data& e) const;
   inline entry * first_entry(const U64& key) const;
   void clear() const;
+
+  // bumped once per search, entries of older searches are replaced first
+  void new_search() const { generation.fetch_add(1, std::memory_order_relaxed); }
+  U8 age() const { return generation.load(std::memory_order_relaxed); }
 };
 
 inline entry * hash_table::first_entry(const U64& key) const
@@ -0,0 +1,209 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of the Havoc chess engine
+Copyright (c) 2020 Minniesoft
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#pragma once
+
+#ifndef MATCH_H
+#define MATCH_H
+
+#include <string>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <mutex>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+#include "selfplay.h"
+#include "pgn.h"
+#include "threads.h"
+#include "parameter.h"
+#include "utils.h"
+
+// in-process engine match between two parameter sets with an sprt stop rule.
+// game pairs (same opening, colors swapped) run concurrently, one slot per
+// worker thread with its own hash tables, so no external gui or uci pipes
+namespace match {
+
+  struct settings {
+    unsigned games = 1000;      // upper bound, sprt may stop earlier
+    unsigned depth = 6;
+    unsigned threads = 1;
+    unsigned opening_plies = 8; // random plies, or plies taken from pgn openings
+    double elo0 = 0, elo1 = 5, alpha = 0.05, beta = 0.05;
+  };
+
+  struct tally {
+    unsigned wins = 0, draws = 0, losses = 0; // from the first engine's point of view
+
+    unsigned games() const { return wins + draws + losses; }
+    double score() const { return games() ? (wins + 0.5 * draws) / games() : 0.5; }
+  };
+
+  inline double elo(const double& score) {
+    const double s = std::min(std::max(score, 1e-6), 1.0 - 1e-6);
+    return -400.0 * std::log10(1.0 / s - 1.0);
+  }
+
+  // trinomial sprt log-likelihood ratio (normal approximation) of elo1 vs elo0
+  inline double llr(const tally& t, const double& elo0, const double& elo1) {
+    const double n = t.games();
+    if (n == 0 || t.wins + t.losses == 0) return 0;
+    const double s = t.score();
+    const double var = (t.wins * std::pow(1.0 - s, 2) + t.draws * std::pow(0.5 - s, 2) + t.losses * std::pow(s, 2)) / n;
+    if (var <= 0) return 0;
+    const double s0 = 1.0 / (1.0 + std::pow(10.0, -elo0 / 400.0));
+    const double s1 = 1.0 / (1.0 + std::pow(10.0, -elo1 / 400.0));
+    return n * (s1 - s0) * (2 * s - s0 - s1) / (2 * var);
+  }
+
+  // reads "key:value" lines of an engine.conf into a copy of the default parameters
+  inline bool load_params(const std::string& filename, parameters& params) {
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+      std::cout << "..failed to open param file " << filename << std::endl;
+      return false;
+    }
+    std::string line;
+    unsigned n = 0;
+    while (std::getline(in, line)) {
+      ++n;
+      std::vector<std::string> tokens = util::split(line, ':');
+      if (tokens.size() != 2) continue;
+      try {
+        if (tokens[0] == "fixed depth") { params.fixed_depth = std::stoi(tokens[1]); continue; }
+        bool known = false;
+        for (auto& t : params.conf_values()) {
+          if (t.first == tokens[0]) { *t.second = std::stof(tokens[1]); known = true; break; }
+        }
+        if (!known) std::cout << "..ignoring unknown param '" << tokens[0] << "' in " << filename << ":" << n << std::endl;
+      }
+      catch (const std::exception&) {
+        std::cout << "..bad value in " << filename << ":" << n << ": " << line << std::endl;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // opening fens from an epd/fen file, or from the first plies of pgn games
+  inline std::vector<std::string> load_openings(const std::string& filename, const unsigned& plies) {
+    std::vector<std::string> fens;
+
+    if (filename.size() > 4 && filename.substr(filename.size() - 4) == ".pgn") {
+      pgn games(std::vector<std::string>{ filename });
+      for (const auto& g : games.parsed_games()) {
+        if (g.moves.size() < plies) continue;
+        position p;
+        std::istringstream fen(START_FEN);
+        p.setup(fen);
+        for (unsigned i = 0; i < plies; ++i) p.do_move(g.moves[i]);
+        fens.push_back(p.to_fen());
+      }
+    }
+    else {
+      std::ifstream in(filename);
+      std::string line;
+      while (std::getline(in, line)) {
+        std::istringstream ss(line);
+        std::string board, stm, castle, ep;
+        if (ss >> board >> stm >> castle >> ep) fens.push_back(board + " " + stm + " " + castle + " " + ep + " 0 1");
+      }
+    }
+    std::cout << "..loaded " << fens.size() << " openings from " << filename << std::endl;
+    return fens;
+  }
+
+  inline void print(const tally& t, const settings& s) {
+    const double n = t.games();
+    const double sc = t.score();
+    const double var = n > 0 ? (t.wins * std::pow(1.0 - sc, 2) + t.draws * std::pow(0.5 - sc, 2) + t.losses * std::pow(sc, 2)) / n : 0;
+    const double margin = n > 0 ? 1.96 * std::sqrt(var / n) : 0;
+    const double lower = std::log(s.beta / (1 - s.alpha));
+    const double upper = std::log((1 - s.beta) / s.alpha);
+
+    std::cout << "games " << t.games() << " +" << t.wins << " =" << t.draws << " -" << t.losses
+      << " score " << sc
+      << " elo " << elo(sc) << " [" << elo(sc - margin) << ", " << elo(sc + margin) << "]"
+      << " llr " << llr(t, s.elo0, s.elo1) << " (" << lower << ", " << upper << ")" << std::endl;
+  }
+
+  // plays engine a against engine b and returns a's tally
+  inline tally run(const parameters& a, const parameters& b, const settings& s, const std::vector<std::string>& openings) {
+    const unsigned slots = std::max(1u, s.threads);
+    const double lower = std::log(s.beta / (1 - s.alpha));
+    const double upper = std::log((1 - s.beta) / s.alpha);
+    const unsigned pairs = (s.games + 1) / 2;
+
+    // openings are fixed up front (cycled from the file, or random)
+    std::mt19937 rng(std::random_device{}());
+    std::vector<std::string> fens(pairs);
+    for (unsigned j = 0; j < pairs; ++j) {
+      fens[j] = openings.empty() ? selfplay::random_opening(rng, s.opening_plies) : openings[j % openings.size()];
+    }
+
+    limits lims{};
+    memset(&lims, 0, sizeof(limits));
+    lims.depth = s.depth;
+
+    tally t;
+    std::mutex m;
+    std::atomic<unsigned> next{ 0 };
+    std::atomic_bool done{ false };
+    Threadpool pool(slots);
+
+    auto add = [&t](const Result& r, const Color& a_color) {
+      if (r == pgn_draw) ++t.draws;
+      else if ((r == pgn_wwin) == (a_color == white)) ++t.wins;
+      else ++t.losses;
+    };
+
+    for (unsigned slot = 0; slot < slots; ++slot) {
+      pool.enqueue([&]() {
+        selfplay::game_tables a_tables(16), b_tables(16); // per engine, see play_game
+        for (unsigned j = next++; j < pairs && !done; j = next++) {
+          Result r1 = selfplay::play_game(fens[j], a, b, lims, a_tables, b_tables);
+          Result r2 = selfplay::play_game(fens[j], b, a, lims, b_tables, a_tables);
+
+          std::unique_lock<std::mutex> lock(m);
+          add(r1, white);
+          add(r2, black);
+          if (t.games() % 100 == 0) print(t, s);
+
+          const double l = llr(t, s.elo0, s.elo1);
+          if (!done && (l <= lower || l >= upper)) done = true;
+        }
+      });
+    }
+    pool.wait_finished();
+
+    const double l = llr(t, s.elo0, s.elo1);
+    print(t, s);
+    std::cout << "sprt (elo0 " << s.elo0 << ", elo1 " << s.elo1 << "): "
+      << (l >= upper ? "H1 accepted" : l <= lower ? "H0 accepted" : "inconclusive") << std::endl;
+    return t;
+  }
+}
+
+#endif
@@ -38,12 +38,15 @@ inline size_t pow2(size_t x) {
 }
 
 
-material_table::material_table() : sz_mb(0), count(0) {
+material_table::material_table() : sz_mb(50 * 1024), count(0) {
+  init();
+}
+
+material_table::material_table(const size_t& mb) : sz_mb(mb * 1024), count(0) {
   init();
 }
 
 void material_table::init() {
-  sz_mb = 50 * 1024;
   count = 1024 * sz_mb / sizeof(material_entry);
   if (count < 1024) count = 1024;
   entries = std::unique_ptr<material_entry[]>(new material_entry[count]());
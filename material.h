@@ -48,6 +48,7 @@ class material_table {
 
   public:
     material_table();
+    explicit material_table(const size_t& mb);
     material_table(const material_table& o) = delete;
     material_table(const material_table&& o) = delete;
     material_table& operator=(const material_table& o) = delete;
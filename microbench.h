@@ -0,0 +1,309 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of the Havoc chess engine
+Copyright (c) 2020 Minniesoft
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+
+#ifdef _MSC_VER
+#  include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#  include <x86intrin.h>
+#endif
+
+#include "types.h"
+#include "position.h"
+#include "move.h"
+#include "magics.h"
+#include "evaluate.h"
+#include "hashtable.h"
+#include "pawns.h"
+#include "material.h"
+#include "bench.h"
+
+// timings of the kernels the search sits on, over the bench positions and
+// every legal move from them.  each kernel runs warmup passes, then a fixed
+// number of samples of at least a couple of ms; the median sample is the
+// number to compare before and after a change
+namespace microbench {
+
+  volatile U64 sink; // keeps the timed work observable
+
+  struct result {
+    std::string name;
+    U64 ops;           // per sample
+    double ns_median;
+    double ns_min;
+    double rsd;        // relative std deviation of the samples
+    double cycles;     // tsc ticks per op at the median, 0 when unavailable
+  };
+
+  inline U64 ticks() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+  }
+
+  // a pass runs the kernel once over the corpus and returns its op count.
+  // prep runs untimed before every pass
+  inline result measure(const std::string& name, unsigned samples,
+			const std::function<void()>& prep, const std::function<U64()>& pass) {
+    typedef std::chrono::steady_clock clock;
+
+    unsigned passes = 0;
+    { // warmup, also sizes a sample to >= 2 ms
+      const auto start = clock::now();
+      do { prep(); pass(); ++passes; }
+      while (std::chrono::duration<double, std::milli>(clock::now() - start).count() < 2.0);
+    }
+
+    std::vector<double> ns(samples), cycles(samples);
+    U64 ops = 0;
+    for (unsigned s = 0; s < samples; ++s) {
+      double elapsed = 0;
+      U64 tsc = 0;
+      ops = 0;
+      for (unsigned i = 0; i < passes; ++i) {
+	prep();
+	const auto t0 = clock::now();
+	const U64 c0 = ticks();
+	ops += pass();
+	tsc += ticks() - c0;
+	elapsed += std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+      }
+      ns[s] = elapsed / std::max(ops, U64(1));
+      cycles[s] = static_cast<double>(tsc) / std::max(ops, U64(1));
+    }
+
+    double mean = 0, var = 0;
+    for (auto& v : ns) mean += v;
+    mean /= samples;
+    for (auto& v : ns) var += (v - mean) * (v - mean);
+
+    std::vector<size_t> order(samples);
+    for (size_t i = 0; i < samples; ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return ns[a] < ns[b]; });
+    const size_t median = order[samples / 2];
+
+    result r;
+    r.name = name;
+    r.ops = ops;
+    r.ns_median = ns[median];
+    r.ns_min = ns[order[0]];
+    r.rsd = mean > 0 ? std::sqrt(var / samples) / mean : 0;
+    r.cycles = cycles[median];
+    return r;
+  }
+
+  inline void print(const result& r) {
+    std::cout << std::left << std::setw(26) << r.name << std::right << std::fixed
+	      << std::setprecision(2) << std::setw(12) << r.ns_median
+	      << std::setw(12) << r.ns_min
+	      << std::setprecision(1) << std::setw(9) << 100.0 * r.rsd;
+    if (r.cycles > 0) std::cout << std::setw(12) << r.cycles;
+    else std::cout << std::setw(12) << "-";
+    std::cout << std::setw(12) << r.ops << std::endl;
+    std::cout.unsetf(std::ios_base::floatfield);
+    std::cout << std::setprecision(6);
+  }
+
+  // microbench [samples] [filter]: filter keeps the kernels whose name
+  // contains it, e.g. "movegen" or "eval"
+  inline void run(unsigned samples, const std::string& filter) {
+    samples = std::max(samples, 3u);
+
+    pawn_table pt(4);
+    material_table mt(1);
+    hash_table tt(16);
+
+    std::vector<std::unique_ptr<position>> corpus;
+    for (const char * f : bench_set::positions) {
+      std::istringstream fen(f);
+      corpus.emplace_back(util::make_unique<position>(fen));
+      corpus.back()->set_hash_table(&tt);
+      corpus.back()->set_eval_tables(&pt, &mt);
+    }
+
+    std::vector<std::vector<Move>> pseudo(corpus.size()), legal(corpus.size()), captures(corpus.size());
+    std::vector<std::unique_ptr<Movegen>> gens;
+    for (size_t i = 0; i < corpus.size(); ++i) {
+      position& p = *corpus[i];
+      Movegen mvs(p);
+      mvs.generate<pseudo_legal, pieces>();
+      for (int j = 0; j < mvs.size(); ++j) {
+	pseudo[i].push_back(mvs[j]);
+	if (!p.is_legal(mvs[j])) continue;
+	legal[i].push_back(mvs[j]);
+	if (mvs[j].type == capture || mvs[j].type == ep ||
+	    (mvs[j].type >= capture_promotion_q && mvs[j].type <= capture_promotion_n))
+	  captures[i].push_back(mvs[j]);
+      }
+      gens.emplace_back(util::make_unique<Movegen>(p));
+    }
+
+    const std::function<void()> none = []() {};
+    auto selected = [&](const std::string& name) { return filter.empty() || name.find(filter) != std::string::npos; };
+    auto bench = [&](const std::string& name, const std::function<void()>& prep, const std::function<U64()>& pass) {
+      if (selected(name)) print(measure(name, samples, prep, pass));
+    };
+
+    std::cout << std::left << std::setw(26) << "kernel" << std::right << std::setw(12) << "ns/op"
+	      << std::setw(12) << "min ns/op" << std::setw(9) << "rsd %" << std::setw(12) << "cycles/op"
+	      << std::setw(12) << "ops/sample" << std::endl;
+
+    // movegen, per piece on a prepared generator and in full from a fresh one
+    auto gen_pass = [&](void (Movegen::*gen)()) {
+      return [&, gen]() {
+	U64 n = 0;
+	for (auto& g : gens) { g->reset(); ((*g).*gen)(); n += g->size(); }
+	sink = n;
+	return static_cast<U64>(gens.size());
+      };
+    };
+    bench("movegen pawn", none, gen_pass(&Movegen::generate<pawn>));
+    bench("movegen knight", none, gen_pass(&Movegen::generate<knight>));
+    bench("movegen bishop", none, gen_pass(&Movegen::generate<bishop>));
+    bench("movegen rook", none, gen_pass(&Movegen::generate<rook>));
+    bench("movegen queen", none, gen_pass(&Movegen::generate<queen>));
+    bench("movegen king", none, gen_pass(&Movegen::generate<king>));
+    bench("movegen all (with init)", none, [&]() {
+      U64 n = 0;
+      for (auto& p : corpus) { Movegen mvs(*p); mvs.generate<pseudo_legal, pieces>(); n += mvs.size(); }
+      sink = n;
+      return static_cast<U64>(corpus.size());
+    });
+
+    bench("do_move + undo_move", none, [&]() {
+      U64 n = 0;
+      for (size_t i = 0; i < corpus.size(); ++i) {
+	position& p = *corpus[i];
+	for (auto& m : legal[i]) { p.do_move(m); p.undo_move(m); ++n; }
+      }
+      sink = corpus[0]->key();
+      return n;
+    });
+
+    bench("is_legal", none, [&]() {
+      U64 n = 0, ok = 0;
+      for (size_t i = 0; i < corpus.size(); ++i) {
+	for (auto& m : pseudo[i]) { ok += corpus[i]->is_legal(m); ++n; }
+      }
+      sink = ok;
+      return n;
+    });
+
+    bench("see (captures)", none, [&]() {
+      U64 n = 0;
+      int v = 0;
+      for (size_t i = 0; i < corpus.size(); ++i) {
+	for (auto& m : captures[i]) { v += corpus[i]->see(m); ++n; }
+      }
+      sink = static_cast<U64>(v);
+      return n;
+    });
+
+    bench("see_ge 0 (legal moves)", none, [&]() {
+      U64 n = 0, ok = 0;
+      for (size_t i = 0; i < corpus.size(); ++i) {
+	for (auto& m : legal[i]) { ok += corpus[i]->see_ge(m, 0); ++n; }
+      }
+      sink = ok;
+      return n;
+    });
+
+    // eval with warm pawn and material tables, then term by term
+    bench("eval::evaluate", none, [&]() {
+      float v = 0;
+      for (auto& p : corpus) v += eval::evaluate(*p, 0);
+      sink = static_cast<U64>(std::abs(v));
+      return static_cast<U64>(corpus.size());
+    });
+
+    std::vector<einfo> infos(corpus.size());
+    for (size_t i = 0; i < corpus.size(); ++i) eval::prepare_terms(*corpus[i], infos[i]);
+    for (unsigned t = 0; t < eval::terms; ++t) {
+      bench(std::string("eval ") + eval::term_names[t], none, [&, t]() {
+	float v = 0;
+	for (size_t i = 0; i < corpus.size(); ++i) v += eval::evaluate_term(*corpus[i], infos[i], static_cast<eval::Term>(t));
+	sink = static_cast<U64>(std::abs(v));
+	return static_cast<U64>(corpus.size());
+      });
+    }
+
+    auto pawn_pass = [&]() {
+      int v = 0;
+      for (auto& p : corpus) v += pt.fetch(*p)->score;
+      sink = static_cast<U64>(v);
+      return static_cast<U64>(corpus.size());
+    };
+    bench("pawn_table::fetch hit", none, pawn_pass);
+    bench("pawn_table::fetch miss", [&]() { pt.clear(); }, pawn_pass);
+
+    // hash table: a save per legal move key, then fetches of the same keys
+    std::vector<U64> keys;
+    for (size_t i = 0; i < corpus.size(); ++i) {
+      for (auto& m : legal[i]) { corpus[i]->do_move(m); keys.push_back(corpus[i]->key()); corpus[i]->undo_move(m); }
+    }
+    const Move nomove{};
+    bench("hash_table::save", none, [&]() {
+      U8 d = 0;
+      for (auto& k : keys) tt.save(k, ++d & 63, bound_exact, 0, nomove, 0, false);
+      return static_cast<U64>(keys.size());
+    });
+    bench("hash_table::fetch", none, [&]() {
+      U64 hits = 0;
+      hash_data e{};
+      for (auto& k : keys) hits += tt.fetch(k, e);
+      sink = hits;
+      return static_cast<U64>(keys.size());
+    });
+
+    auto magic_pass = [&](U64 (*attacks)(const U64&, const Square&)) {
+      return [&, attacks]() {
+	U64 x = 0;
+	for (auto& p : corpus) {
+	  const U64 occ = p->all_pieces();
+	  for (int s = 0; s < squares; ++s) x ^= attacks(occ, static_cast<Square>(s));
+	}
+	sink = x;
+	return static_cast<U64>(corpus.size() * squares);
+      };
+    };
+    bench("magics::attacks bishop", none, magic_pass(&magics::attacks<bishop>));
+    bench("magics::attacks rook", none, magic_pass(&magics::attacks<rook>));
+  }
+}
+
+#endif
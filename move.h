@@ -44,11 +44,8 @@ class Movegen {
   U64 rank2{}, rank7{};
   U64 empty{}, pawns{}, pawns2{}, pawns7{};
   std::vector<U64> bishop_mvs, rook_mvs, queen_mvs;  
-  Square * knights{};
-  Square * bishops{};
-  Square * rooks{};
-  Square * queens{};
-  Square * kings{};
+  U64 knights{}, bishops{}, rooks{}, queens{};
+  Square ks{};
   U64 enemies{}, all_pieces{}, qtarget{}, ctarget{}, check_target{}, evasion_target{};
   Square eps;
   bool can_castle_ks{}, can_castle_qs{};
@@ -70,7 +67,7 @@ class Movegen {
   inline void encode_capture_promotions(U64& b, const int& dir);
   
  public:
-  Movegen() : last(0), list{}, us(), them(), rank2(0), rank7(0), empty(0), pawns(0), pawns2(0), pawns7(0), knights(nullptr), bishops(nullptr), rooks(nullptr), queens(nullptr), kings(nullptr), enemies(0), all_pieces(0), qtarget(0), ctarget(0), check_target(0), evasion_target(0), eps(), can_castle_ks(false), can_castle_qs(false)
+  Movegen() : last(0), list{}, us(), them(), rank2(0), rank7(0), empty(0), pawns(0), pawns2(0), pawns7(0), knights(0), bishops(0), rooks(0), queens(0), ks(no_square), enemies(0), all_pieces(0), qtarget(0), ctarget(0), check_target(0), evasion_target(0), eps(), can_castle_ks(false), can_castle_qs(false)
   {
   }
 
@@ -132,28 +132,27 @@ inline void Movegen::initialize(const position& p) {
     rank2 = bitboards::row[r2];
     rank7 = bitboards::row[r7];
     pawns = p.get_pieces<white, pawn>();
-    knights = p.squares_of<white, knight>();    
-    bishops = p.squares_of<white, bishop>();
-    rooks = p.squares_of<white, rook>();
-    queens = p.squares_of<white, queen>();
-    kings = p.squares_of<white, king>();
+    knights = p.get_pieces<white, knight>();    
+    bishops = p.get_pieces<white, bishop>();
+    rooks = p.get_pieces<white, rook>();
+    queens = p.get_pieces<white, queen>();
     enemies = p.get_pieces<black>();
   }
   else {
     rank2 = bitboards::row[r7];
     rank7 = bitboards::row[r2];
     pawns = p.get_pieces<black, pawn>();
-    knights = p.squares_of<black, knight>();
-    bishops = p.squares_of<black, bishop>();
-    rooks = p.squares_of<black, rook>();
-    queens = p.squares_of<black, queen>();
-    kings = p.squares_of<black, king>();
+    knights = p.get_pieces<black, knight>();
+    bishops = p.get_pieces<black, bishop>();
+    rooks = p.get_pieces<black, rook>();
+    queens = p.get_pieces<black, queen>();
     enemies = p.get_pieces<white>();
   }
 
   qtarget = (evasion_target != 0ULL ? evasion_target : empty);
   ctarget = (check_target == 0ULL ? enemies : check_target);
 
+  ks = p.king_square(us);
   eps = p.eps();
   pawns2 = pawns & rank2;
   pawns7 = pawns & rank7;
@@ -315,28 +314,31 @@ inline void Movegen::generate<capture_promotion, pawn>() {
 //------------------------------
 template<>
 inline void Movegen::generate<quiet, knight>() {
-  for (Square * s = &knights[0]; *s != no_square; ++s) {
-    U64 mvs = bitboards::nmask[*s] & qtarget;    
-    if (mvs != 0ULL) encode<quiet>(mvs, *s);
+  for (U64 b = knights; b; ) {
+    const auto s = static_cast<Square>(bits::pop_lsb(b));
+    U64 mvs = bitboards::nmask[s] & qtarget;    
+    if (mvs != 0ULL) encode<quiet>(mvs, s);
   }
 }
 
 template<>
 inline void Movegen::generate<capture, knight>() {
-  for (Square * s = &knights[0]; *s != no_square; ++s) {
-    U64 mvs = bitboards::nmask[*s] & ctarget;     
-    if ( mvs != 0ULL) encode<capture>(mvs, *s);
+  for (U64 b = knights; b; ) {
+    const auto s = static_cast<Square>(bits::pop_lsb(b));
+    U64 mvs = bitboards::nmask[s] & ctarget;     
+    if ( mvs != 0ULL) encode<capture>(mvs, s);
   }
 }
 
 template<>
 inline void Movegen::generate<pseudo_legal, knight>() {  
-  for (Square * s = &knights[0]; *s != no_square; ++s) {
-    U64 qmvs = bitboards::nmask[*s] & qtarget;     
-    if (qmvs != 0ULL) encode<quiet>(qmvs, *s);
+  for (U64 b = knights; b; ) {
+    const auto s = static_cast<Square>(bits::pop_lsb(b));
+    U64 qmvs = bitboards::nmask[s] & qtarget;     
+    if (qmvs != 0ULL) encode<quiet>(qmvs, s);
     
-    U64 cmvs = bitboards::nmask[*s] & ctarget;     
-    if (cmvs != 0ULL) encode<capture>(cmvs, *s);
+    U64 cmvs = bitboards::nmask[s] & ctarget;     
+    if (cmvs != 0ULL) encode<capture>(cmvs, s);
   }
 }
 
@@ -345,30 +347,33 @@ inline void Movegen::generate<pseudo_legal, knight>() {
 //------------------------------
 template<>
 inline void Movegen::generate<quiet, bishop>() {
-  for (Square * s = &bishops[0]; *s != no_square; ++s) {
-    U64 mvs = magics::attacks<bishop>(all_pieces, *s) & qtarget;
-    if (mvs != 0ULL) encode<quiet>(mvs, *s);
+  for (U64 b = bishops; b; ) {
+    const auto s = static_cast<Square>(bits::pop_lsb(b));
+    U64 mvs = magics::attacks<bishop>(all_pieces, s) & qtarget;
+    if (mvs != 0ULL) encode<quiet>(mvs, s);
   }  
 }
 
 template<>
 inline void Movegen::generate<capture, bishop>() {
-  for (Square * s = &bishops[0]; *s != no_square; ++s) {
-    U64 mvs = magics::attacks<bishop>(all_pieces, *s) & ctarget;
-    if (mvs != 0ULL) encode<capture>(mvs, *s);
+  for (U64 b = bishops; b; ) {
+    const auto s = static_cast<Square>(bits::pop_lsb(b));
+    U64 mvs = magics::attacks<bishop>(all_pieces, s) & ctarget;
+    if (mvs != 0ULL) encode<capture>(mvs, s);
   }
 }
 
 template<>
 inline void Movegen::generate<pseudo_legal, bishop>() {
-  for (Square * s = &bishops[0]; *s != no_square; ++s){ 
-    U64 mvs = magics::attacks<bishop>(all_pieces, *s);
+  for (U64 b = bishops; b; ) {
+    const auto s = static_cast<Square>(bits::pop_lsb(b));
+    U64 mvs = magics::attacks<bishop>(all_pieces, s);
 
     U64 q = mvs & qtarget;
-    if (q != 0ULL) encode<quiet>(q, *s);
+    if (q != 0ULL) encode<quiet>(q, s);
     
     U64 c = mvs & ctarget;
-    if (c != 0ULL) encode<capture>(c, *s);
+    if (c != 0ULL) encode<capture>(c, s);
   }
 }
 
@@ -377,30 +382,33 @@ inline void Movegen::generate<pseudo_legal, bishop>() {
 //------------------------------
 template<>
 inline void Movegen::generate<quiet, rook>() {
-  for (Square * s = &rooks[0]; *s != no_square; ++s) {
-    U64 mvs = magics::attacks<rook>(all_pieces, *s) & qtarget;
-    if (mvs != 0ULL) encode<quiet>(mvs, *s);
+  for (U64 b = rooks; b; ) {
+    const auto s = static_cast<Square>(bits::pop_lsb(b));
+    U64 mvs = magics::attacks<rook>(all_pieces, s) & qtarget;
+    if (mvs != 0ULL) encode<quiet>(mvs, s);
   }   
 }
 
 template<>
 inline void Movegen::generate<capture, rook>() {  
-  for (Square * s = &rooks[0]; *s != no_square; ++s) {
-    U64 mvs = magics::attacks<rook>(all_pieces, *s) & ctarget;
-    if (mvs != 0ULL) encode<capture>(mvs, *s);
+  for (U64 b = rooks; b; ) {
+    const auto s = static_cast<Square>(bits::pop_lsb(b));
+    U64 mvs = magics::attacks<rook>(all_pieces, s) & ctarget;
+    if (mvs != 0ULL) encode<capture>(mvs, s);
   }
 }
 
 template<>
 inline void Movegen::generate<pseudo_legal, rook>() {  
-  for (Square * s = &rooks[0]; *s != no_square; ++s) {
-    U64 mvs = magics::attacks<rook>(all_pieces, *s);
+  for (U64 b = rooks; b; ) {
+    const auto s = static_cast<Square>(bits::pop_lsb(b));
+    U64 mvs = magics::attacks<rook>(all_pieces, s);
 
     U64 q = mvs & qtarget;
-    if (q != 0ULL) encode<quiet>(q, *s);
+    if (q != 0ULL) encode<quiet>(q, s);
 
     U64 c = mvs & ctarget;
-    if (c != 0ULL) encode<capture>(c, *s);
+    if (c != 0ULL) encode<capture>(c, s);
   }
 }
 
@@ -409,35 +417,38 @@ inline void Movegen::generate<pseudo_legal, rook>() {
 //------------------------------
 template<>
 inline void Movegen::generate<quiet, queen>() {
-  for (Square * s = &queens[0]; *s != no_square; ++s) {
-    U64 mvs = (magics::attacks<bishop>(all_pieces, *s) |
-	       magics::attacks<rook>(all_pieces, *s)) & qtarget;
-    if (mvs != 0ULL) encode<quiet>(mvs, *s);
+  for (U64 b = queens; b; ) {
+    const auto s = static_cast<Square>(bits::pop_lsb(b));
+    U64 mvs = (magics::attacks<bishop>(all_pieces, s) |
+	       magics::attacks<rook>(all_pieces, s)) & qtarget;
+    if (mvs != 0ULL) encode<quiet>(mvs, s);
   }   
 }
 
 template<>
 inline void Movegen::generate<capture, queen>() {
 
-  for (Square * s = &queens[0]; *s != no_square; ++s) {
-    U64 mvs = (magics::attacks<bishop>(all_pieces, *s) |
-	       magics::attacks<rook>(all_pieces, *s)) & ctarget;
-    if (mvs != 0ULL) encode<capture>(mvs, *s);
+  for (U64 b = queens; b; ) {
+    const auto s = static_cast<Square>(bits::pop_lsb(b));
+    U64 mvs = (magics::attacks<bishop>(all_pieces, s) |
+	       magics::attacks<rook>(all_pieces, s)) & ctarget;
+    if (mvs != 0ULL) encode<capture>(mvs, s);
   }
 }
 
 template<>
 inline void Movegen::generate<pseudo_legal, queen>() {
 
-  for (Square * s = &queens[0]; *s != no_square; ++s) {
-    U64 mvs = (magics::attacks<bishop>(all_pieces, *s) |
-	       magics::attacks<rook>(all_pieces, *s));
+  for (U64 b = queens; b; ) {
+    const auto s = static_cast<Square>(bits::pop_lsb(b));
+    U64 mvs = (magics::attacks<bishop>(all_pieces, s) |
+	       magics::attacks<rook>(all_pieces, s));
 
     U64 q = mvs & qtarget;
-    if (q != 0ULL) encode<quiet>(q, *s);
+    if (q != 0ULL) encode<quiet>(q, s);
 
     U64 c = mvs & ctarget;
-    if (c != 0ULL) encode<capture>(c, *s);
+    if (c != 0ULL) encode<capture>(c, s);
   }
 }
 
@@ -446,22 +457,22 @@ inline void Movegen::generate<pseudo_legal, queen>() {
 //------------------------------
 template<>
 inline void Movegen::generate<quiet, king>() {
-  U64 mvs = (bitboards::kmask[kings[0]] & empty);
-  if (mvs != 0ULL) encode<quiet>(mvs, kings[0]);
+  U64 mvs = (bitboards::kmask[ks] & empty);
+  if (mvs != 0ULL) encode<quiet>(mvs, ks);
 }
 
 
 template<>
 inline void Movegen::generate<castles, king>() {
-  if (can_castle_ks) list[last++].set(kings[0], (us == white ? G1 : G8), castle_ks);
-  if (can_castle_qs) list[last++].set(kings[0], (us == white ? C1 : C8), castle_qs);
+  if (can_castle_ks) list[last++].set(ks, (us == white ? G1 : G8), castle_ks);
+  if (can_castle_qs) list[last++].set(ks, (us == white ? C1 : C8), castle_qs);
 }
 
 
 template<>
 inline void Movegen::generate<capture, king>() {  
-  U64 mvs = (bitboards::kmask[kings[0]] & enemies);
-  if (mvs != 0ULL) encode<capture>(mvs, kings[0]);
+  U64 mvs = (bitboards::kmask[ks] & enemies);
+  if (mvs != 0ULL) encode<capture>(mvs, ks);
 }
 
 //------------------------------
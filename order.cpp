@@ -26,25 +26,81 @@ THE SOFTWARE.
 move_history& move_history::operator=(const move_history& mh) {  
   std::copy(std::begin(mh.history), std::end(mh.history), std::begin(history));
   std::copy(std::begin(mh.counters), std::end(mh.counters), std::begin(counters));
+  continuation = mh.continuation;
+  capture_history = mh.capture_history;
   return (*this);
 }
 
+// ply 1: earlier is the opponent's last move, ply 2 our move before it.  the
+// mover's color is part of the index, so white and black keep separate tables.
+// -1 when there is no such move or its piece has since been captured
+int move_history::continuation_index(const position& p, const unsigned& ply, const Move& earlier, const Move& m) const {
+  if (earlier.f == earlier.t || earlier.type == no_type) return -1;
+  const Piece ep = p.piece_on(static_cast<Square>(earlier.t));
+  const Piece mp = p.piece_on(static_cast<Square>(m.f));
+  if (ep >= pieces || mp >= pieces) return -1;
+  const Color mc = p.color_on(static_cast<Square>(m.f));
+  const Color ec = p.color_on(static_cast<Square>(earlier.t));
+  if ((ply == 1) != (ec != mc)) return -1;
+  return (((((ply - 1) * colors + mc) * pieces + ep) * squares + earlier.t) * pieces + mp) * squares + m.t;
+}
+
+int16& move_history::capture_entry(const position& p, const Move& m) {
+  const Piece mp = p.piece_on(static_cast<Square>(m.f));
+  const Piece cp = p.piece_on(static_cast<Square>(m.t));
+  return capture_history[mp < pieces ? mp : pawn][m.t][cp < pieces ? cp : pawn]; // ep: empty target
+}
+
+int move_history::continuation_score(const position& p, const Move& m, const Move& previous, const Move& followup) const {
+  int score = 0;
+  const int i1 = continuation_index(p, 1, previous, m);
+  if (i1 >= 0) score += continuation[i1];
+  const int i2 = (followup.t != previous.t ? continuation_index(p, 2, followup, m) : -1);
+  if (i2 >= 0) score += continuation[i2];
+  return score;
+}
+
+int move_history::capture_score(const position& p, const Move& m) const {
+  const Piece mp = p.piece_on(static_cast<Square>(m.f));
+  const Piece cp = p.piece_on(static_cast<Square>(m.t));
+  return capture_history[mp < pieces ? mp : pawn][m.t][cp < pieces ? cp : pawn];
+}
+
 void move_history::update(const position& p,
 			  const Move& m,
 			  const Move& previous,
+			  const Move& followup,
 			  const int16& depth,
 			  const Score& eval,
 			  const std::vector<Move>& quiets,
+			  const std::vector<Move>& captures,
 			  Move * killers) {
   
   const Color c = p.to_move();
   int score = pow(depth, 2);
+  const int bonus = std::min(16 * depth * depth, 2048);
+
+  // capture history: the cut move up, the captures tried before it down
+  if (m.type != quiet) {
+    for (auto& cm : captures) age(capture_entry(p, cm), cm == m ? bonus : -bonus);
+    return;
+  }
   
   if (m.type == quiet) {
 
     history[c][m.f][m.t] += score;
     counters[previous.f][previous.t] = m;
 
+    // continuation history: the cut move up, the quiets tried before it down
+    for (unsigned ply = 1; ply <= 2; ++ply) {
+      const Move& earlier = (ply == 1 ? previous : followup);
+      if (ply == 2 && followup.t == previous.t) break;
+      for (auto& q : quiets) {
+        const int i = continuation_index(p, ply, earlier, q);
+        if (i >= 0) age(continuation[i], q == m ? bonus : -bonus);
+      }
+    }
+
     if (eval >= mate_max_ply &&
       m != killers[0] &&
       m != killers[1] &&
@@ -77,6 +133,8 @@ void move_history::update(const position& p,
 
 void move_history::clear() { 
   for (auto& v : history) { for (auto& w : v) { std::fill(w.begin(), w.end(), 0); } }
+  std::fill(continuation.begin(), continuation.end(), static_cast<int16>(0));
+  for (auto& v : capture_history) { for (auto& w : v) { std::fill(w.begin(), w.end(), static_cast<int16>(0)); } }
 
   Move empty{}; empty.set(0, 0, no_type);
   for (auto& v : counters) { std::fill(v.begin(), v.end(), empty); }
@@ -84,8 +142,8 @@ void move_history::clear() {
 
 
 template<>
-int move_history::score<white>(const Move& m, const Move& previous, const Move& followup, const Move& threat) {
-  int score = history[white][m.f][m.t];
+int move_history::score<white>(const position& p, const Move& m, const Move& previous, const Move& followup, const Move& threat) {
+  int score = history[white][m.f][m.t] + continuation_score(p, m, previous, followup);
   if (counters[previous.f][previous.t] == m) score += counter_move_bonus;
   if (followup.t == m.f) score -= counter_move_bonus; // moving the same piece multiple times..
   if (m.f == threat.t) score += threat_evasion_bonus;
@@ -97,8 +155,8 @@ int move_history::score<white>(const Move& m, const Move& previous, const Move&
 }
 
 template<>
-int move_history::score<black>(const Move& m, const Move& previous, const Move& followup, const Move& threat) {
-  int score = history[black][m.f][m.t];
+int move_history::score<black>(const position& p, const Move& m, const Move& previous, const Move& followup, const Move& threat) {
+  int score = history[black][m.f][m.t] + continuation_score(p, m, previous, followup);
   if (counters[previous.f][previous.t] == m) score += counter_move_bonus;
   if (followup.t == m.f) score -= counter_move_bonus; // moving the same piece multiple times..
   if (m.f == threat.t) score += threat_evasion_bonus;
@@ -116,9 +174,10 @@ scored_move& scored_move::operator=(const scored_move& o) = default;
 
 move_order::move_order(position& p,
                        Move& hashmv,
-                       Move * kill) :
+                       Move * kill,
+                       bool gen_checks) :
   phase(hash_move), hashmove(&hashmv),
-  killers(kill), to_move(p.to_move()), incheck(p.in_check()) {
+  killers(kill), to_move(p.to_move()), incheck(p.in_check()), checks(gen_checks && !incheck) {
   
   if (!p.is_legal_hashmove(hashmv)) { hashmove->f = static_cast<Square>(0); hashmove->t = static_cast<Square>(0); hashmove->type = no_type; }
   
@@ -218,6 +277,12 @@ bool move_order::next_move<main0>(position& pos, Move& m, const Move& previous,
           //Score(pos.see((*moves)[i]));
           static_cast<Score>(mvals[pt] - mvals[pf]);
 
+        // capture history breaks ties within an mvv-lva class, without moving
+        // a capture across the good/bad split
+        int h = stats->capture_score(pos, (*moves)[i]) / 256;
+        h = (sc == 0 ? std::max(h, 0) : h);
+        sc = static_cast<Score>(64 * sc + std::max(-63, std::min(63, h)));
+
         // promotions
         if (m.type == capture_promotion_q) sc = static_cast<Score>(sc + 81); // ordering material values - pawn value
         if (m.type == capture_promotion_r) sc = static_cast<Score>(sc + 38);
@@ -273,8 +338,8 @@ bool move_order::next_move<main0>(position& pos, Move& m, const Move& previous,
   case quiets : {
     if (list.empty()) {
       
-      auto ss = [this](const Move& m, const Move& previous, const Move& followup, const Move& threat) {
-        return static_cast<Score>(to_move == white ? stats->score<white>(m, previous, followup, threat) : stats->score<black>(m, previous, followup, threat)); };
+      auto ss = [this, &pos](const Move& m, const Move& previous, const Move& followup, const Move& threat) {
+        return static_cast<Score>(to_move == white ? stats->score<white>(pos, m, previous, followup, threat) : stats->score<black>(pos, m, previous, followup, threat)); };
       
       moves->generate<quiet, pieces>();
       for (int i = 0; i < moves->size(); ++i) {
@@ -425,15 +490,17 @@ bool move_order::next_move<qsearch>(position& pos, Move& m, const Move& previous
 
     
   case quiets : {
-    if (list.empty() && incheck) {
+    // evasions when in check, quiet checks when asked for (first qsearch ply)
+    if (list.empty() && (incheck || checks)) {
       
-      auto ss = [this](const Move& m, const Move& previous, const Move& followup, const Move& threat) {
-		  return static_cast<Score>(to_move == white ? stats->score<white>(m, previous, followup, threat) : stats->score<black>(m, previous, followup, threat)); };
+      auto ss = [this, &pos](const Move& m, const Move& previous, const Move& followup, const Move& threat) {
+		  return static_cast<Score>(to_move == white ? stats->score<white>(pos, m, previous, followup, threat) : stats->score<black>(pos, m, previous, followup, threat)); };
       
       moves->generate<quiet, pieces>();
       for (int i = 0; i < moves->size(); ++i) {
         
         if (skip((*moves)[i])) continue;
+        if (!incheck && ((*moves)[i].type != quiet || !pos.gives_check((*moves)[i]))) continue;
         
         Score sc = ss((*moves)[i], previous, followup, threat);
         
@@ -30,6 +30,7 @@ THE SOFTWARE.
 #include <memory>
 #include <algorithm>
 #include <iostream>
+#include <cstdlib>
 
 #include "types.h"
 
@@ -41,10 +42,21 @@ struct move_history {
   std::array<std::array<std::array<int, squares>, squares>, colors> history{};
   std::array<std::array<Move, squares>, squares> counters{};
 
+  // continuation history (previous piece, previous to) x (piece, to), one
+  // table for the opponent's last move (1 ply) and one for our move before
+  // it (2 ply), each per color.  on the heap, it is too large for a position
+  // on the stack
+  std::vector<int16> continuation;
+
+  // capture history (piece, to, captured piece)
+  std::array<std::array<std::array<int16, pieces>, squares>, pieces> capture_history{};
+
+  static const int history_max = 16384;
+
   float counter_move_bonus = 1.0f;
   float threat_evasion_bonus = 1.0f;
 
-  move_history() { clear(); }
+  move_history() : continuation(2 * colors * pieces * squares * pieces * squares, 0) { clear(); }
     
   move_history& operator=(const move_history& mh);
   
@@ -52,14 +64,23 @@ struct move_history {
   void update(const position& p,
 	      const Move& m,
 	      const Move& previous,
+	      const Move& followup,
 	      const int16& depth,
 	      const Score& eval,
 	      const std::vector<Move>& quiets,
+	      const std::vector<Move>& captures,
 	      Move * killers);
   
   void clear();
   
-  template<Color c> int score(const Move& m, const Move& previous, const Move& followup, const Move& threat);
+  int continuation_score(const position& p, const Move& m, const Move& previous, const Move& followup) const;
+  int capture_score(const position& p, const Move& m) const;
+  template<Color c> int score(const position& p, const Move& m, const Move& previous, const Move& followup, const Move& threat);
+
+ private:
+  int continuation_index(const position& p, const unsigned& ply, const Move& earlier, const Move& m) const;
+  int16& capture_entry(const position& p, const Move& m);
+  static void age(int16& entry, const int& bonus) { entry += bonus - entry * std::abs(bonus) / history_max; }
 };
 
 
@@ -90,14 +111,15 @@ class move_order {
   Move * killers;
   Color to_move;
   bool incheck;
+  bool checks; // qsearch: also return quiet checking moves
   std::vector<scored_move> list;
 
  public:
-  move_order(): phase(), hashmove(nullptr), stats(nullptr), moves(nullptr), killers(nullptr), to_move(), incheck(false)
+  move_order(): phase(), hashmove(nullptr), stats(nullptr), moves(nullptr), killers(nullptr), to_move(), incheck(false), checks(false)
   {
   }
 
-  move_order(position& p, Move& hashmove, Move * kill);
+  move_order(position& p, Move& hashmove, Move * kill, bool gen_checks = false);
   move_order(const move_order& mo) = delete;
   move_order(const move_order&& mo) = delete;  
   move_order& operator=(const move_order& o) = delete;
@@ -0,0 +1,231 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of the Havoc chess engine
+Copyright (c) 2020 Minniesoft
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#include <cstring>
+#include <sstream>
+#include <random>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "packed.h"
+#include "position.h"
+#include "utils.h"
+
+
+bool packed_writer::open(const std::string& filename, bool append) {
+  close();
+  out.open(filename, std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+  written = 0;
+  buffer.reserve(4096);
+  return out.is_open();
+}
+
+void packed_writer::write(const packed_position& pp) {
+  buffer.push_back(pp);
+  if (buffer.size() >= 4096) flush();
+}
+
+void packed_writer::write(const position& p, const Result& r, const int16& score) {
+  packed_position pp{};
+  p.pack(pp);
+  pp.result = static_cast<U8>(r);
+  pp.score = score;
+  write(pp);
+}
+
+void packed_writer::flush() {
+  if (!out.is_open() || buffer.empty()) return;
+  out.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(packed_position));
+  written += buffer.size();
+  buffer.clear();
+}
+
+void packed_writer::close() {
+  if (!out.is_open()) return;
+  flush();
+  out.close();
+}
+
+
+#ifdef _MSC_VER
+packed_file::packed_file() : data(nullptr), count(0), perm_a(1), perm_b(0), bytes(0),
+  file_handle(INVALID_HANDLE_VALUE), map_handle(nullptr) { }
+#else
+packed_file::packed_file() : data(nullptr), count(0), perm_a(1), perm_b(0), bytes(0), fd(-1) { }
+#endif
+
+packed_file::packed_file(const std::string& filename) : packed_file() { open(filename); }
+
+
+bool packed_file::open(const std::string& filename) {
+  close();
+
+#ifdef _MSC_VER
+  file_handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+    OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+  if (file_handle == INVALID_HANDLE_VALUE) return false;
+
+  LARGE_INTEGER sz;
+  GetFileSizeEx(file_handle, &sz);
+  bytes = static_cast<size_t>(sz.QuadPart);
+  if (bytes < sizeof(packed_position)) { close(); return false; }
+
+  map_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (map_handle == nullptr) { close(); return false; }
+
+  data = static_cast<const packed_position*>(MapViewOfFile(map_handle, FILE_MAP_READ, 0, 0, 0));
+#else
+  fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat st{};
+  fstat(fd, &st);
+  bytes = static_cast<size_t>(st.st_size);
+  if (bytes < sizeof(packed_position)) { close(); return false; }
+
+  void * addr = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+  data = (addr == MAP_FAILED ? nullptr : static_cast<const packed_position*>(addr));
+  if (data) madvise(addr, bytes, MADV_RANDOM);
+#endif
+
+  if (data == nullptr) { close(); return false; }
+
+  count = bytes / sizeof(packed_position);
+  perm_a = 1;
+  perm_b = 0;
+  return true;
+}
+
+
+void packed_file::close() {
+#ifdef _MSC_VER
+  if (data) UnmapViewOfFile(data);
+  if (map_handle) CloseHandle(map_handle);
+  if (file_handle != INVALID_HANDLE_VALUE) CloseHandle(file_handle);
+  map_handle = nullptr;
+  file_handle = INVALID_HANDLE_VALUE;
+#else
+  if (data) munmap(const_cast<packed_position*>(data), bytes);
+  if (fd >= 0) ::close(fd);
+  fd = -1;
+#endif
+  data = nullptr;
+  count = 0;
+  bytes = 0;
+}
+
+
+void packed_file::shuffle(const U64& seed) {
+  if (count < 2) return;
+
+  auto gcd = [](U64 a, U64 b) { while (b) { U64 t = a % b; a = b; b = t; } return a; };
+
+  // a large multiplier (~0.618 * count) co-prime with count spreads neighbouring
+  // indices (positions of the same game) across the whole file.
+  // keep a * idx inside 64 bits for files of up to 2^32 records
+  std::mt19937_64 rng(seed);
+  U64 span = std::min<U64>(count, 1ULL << 32);
+  U64 a = static_cast<U64>(0.6180339887 * span) + rng() % std::max<U64>(1, span / 16);
+  a = std::max<U64>(1, a % span);
+  while (gcd(a, count) != 1) a = (a + 1) % span == 0 ? 1 : a + 1;
+
+  perm_a = a;
+  perm_b = rng() % count;
+}
+
+
+size_t packed::from_pgn(const std::vector<std::string>& pgn_files, const std::string& out, const unsigned& skip_plies) {
+  pgn games(pgn_files);
+  packed_writer writer(out);
+
+  for (const auto& g : games.parsed_games()) {
+    if (!g.finished()) continue;
+
+    position p;
+    std::istringstream fen(START_FEN);
+    p.setup(fen);
+
+    unsigned ply = 0;
+    for (const auto& m : g.moves) {
+      if (ply++ >= skip_plies && !p.in_check()) writer.write(p, g.result);
+      p.do_move(m);
+    }
+  }
+
+  writer.close();
+  std::cout << "..packed " << writer.size() << " positions into " << out << std::endl;
+  return writer.size();
+}
+
+
+// epd lines are expected as "<board> <stm> <castle> <ep> [opcodes]" where the
+// result comes from a c9 "1-0" style opcode or a trailing [1.0]/[0.5]/[0.0]
+// tag and an optional centipawn score from "ce <n>"
+size_t packed::from_epd(const std::string& epd_file, const std::string& out) {
+  std::ifstream in(epd_file);
+  packed_writer writer(out);
+  std::string line;
+
+  if (!in.is_open()) {
+    std::cout << "..failed to open epd file " << epd_file << std::endl;
+    return 0;
+  }
+
+  while (std::getline(in, line)) {
+    std::istringstream ss(line);
+    std::string board, stm, castle, ep;
+    if (!(ss >> board >> stm >> castle >> ep)) continue;
+
+    std::string rest;
+    std::getline(ss, rest);
+
+    Result r = pgn_none;
+    if (rest.find("1/2-1/2") != std::string::npos || rest.find("[0.5]") != std::string::npos) r = pgn_draw;
+    else if (rest.find("1-0") != std::string::npos || rest.find("[1.0]") != std::string::npos) r = pgn_wwin;
+    else if (rest.find("0-1") != std::string::npos || rest.find("[0.0]") != std::string::npos) r = pgn_bwin;
+
+    int16 score = packed_no_score;
+    size_t ce = rest.find("ce ");
+    if (ce != std::string::npos) {
+      std::istringstream cs(rest.substr(ce + 3));
+      int v = 0;
+      if (cs >> v) score = static_cast<int16>(std::max(-32767, std::min(32767, v)));
+    }
+
+    position p;
+    std::istringstream fen(board + " " + stm + " " + castle + " " + ep + " 0 1");
+    p.setup(fen);
+    writer.write(p, r, score);
+  }
+
+  writer.close();
+  std::cout << "..packed " << writer.size() << " positions into " << out << std::endl;
+  return writer.size();
+}
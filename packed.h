@@ -0,0 +1,124 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of the Havoc chess engine
+Copyright (c) 2020 Minniesoft
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#pragma once
+
+#ifndef PACKED_H
+#define PACKED_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "types.h"
+#include "pgn.h"
+
+// 32 byte training record: occupancy + one nibble per occupied square
+// (a1..h8 order, (color << 3) | piece), side to move, castle rights,
+// game result (pgn Result) and an optional search score (side to move pov)
+struct packed_position {
+  U64 occupied;
+  U8 pieces[16];
+  int16 score;
+  U8 result;
+  U8 flags; // bit 0 side to move, bits 1-4 castle mask
+  U8 eps;
+  U8 move50;
+  U16 hmvs;
+
+  Color stm() const { return static_cast<Color>(flags & 1); }
+  U16 cmask() const { return static_cast<U16>((flags >> 1) & 15); }
+  bool has_score() const;
+};
+
+static_assert(sizeof(packed_position) == 32, "packed_position must stay 32 bytes");
+
+const int16 packed_no_score = -32768;
+
+inline bool packed_position::has_score() const { return score != packed_no_score; }
+
+
+// buffered append-only writer
+class packed_writer {
+  std::ofstream out;
+  std::vector<packed_position> buffer;
+  size_t written;
+
+ public:
+  packed_writer() : written(0) { }
+  packed_writer(const std::string& filename, bool append = false) : written(0) { open(filename, append); }
+  packed_writer(const packed_writer& o) = delete;
+  packed_writer(const packed_writer&& o) = delete;
+  packed_writer& operator=(const packed_writer& o) = delete;
+  packed_writer& operator=(const packed_writer&& o) = delete;
+  ~packed_writer() { close(); }
+
+  bool open(const std::string& filename, bool append = false);
+  void write(const packed_position& pp);
+  void write(const position& p, const Result& r, const int16& score = packed_no_score);
+  void flush();
+  void close();
+  size_t size() const { return written + buffer.size(); }
+};
+
+
+// read-only memory mapped view of a packed file with O(1) random access,
+// at() walks the records in a seeded pseudo-random order without an index array
+class packed_file {
+  const packed_position * data;
+  size_t count;
+  U64 perm_a, perm_b; // i -> (a * i + b) mod count, gcd(a, count) == 1
+  size_t bytes;
+#ifdef _MSC_VER
+  void * file_handle;
+  void * map_handle;
+#else
+  int fd;
+#endif
+
+ public:
+  packed_file();
+  packed_file(const std::string& filename);
+  packed_file(const packed_file& o) = delete;
+  packed_file(const packed_file&& o) = delete;
+  packed_file& operator=(const packed_file& o) = delete;
+  packed_file& operator=(const packed_file&& o) = delete;
+  ~packed_file() { close(); }
+
+  bool open(const std::string& filename);
+  void close();
+  void shuffle(const U64& seed);
+
+  size_t size() const { return count; }
+  const packed_position& operator[](const size_t& idx) const { return data[idx]; }
+  const packed_position& at(const size_t& idx) const {
+    return data[(perm_a * (idx % count) + perm_b) % count];
+  }
+};
+
+
+namespace packed {
+  // converters return the number of records written
+  size_t from_pgn(const std::vector<std::string>& pgn_files, const std::string& out, const unsigned& skip_plies = 8);
+  size_t from_epd(const std::string& epd_file, const std::string& out);
+}
+
+#endif
@@ -26,6 +26,10 @@ THE SOFTWARE.
 #include <bitset>
 #include <string>
 #include <iostream>
+#include <utility>
+#include <vector>
+
+#include "types.h"
 
 
 template<typename T>
@@ -95,6 +99,52 @@ struct parameters {
     return *this;
   }
 
+  // the tuneable subset keyed by its engine.conf name (same order as the pbil encoding)
+  std::vector<std::pair<std::string, float*>> tuneables() {
+    return {
+      { "tempo", &tempo },
+      { "pawn ss", &sq_score_scaling[pawn] },
+      { "knight ss", &sq_score_scaling[knight] },
+      { "bishop ss", &sq_score_scaling[bishop] },
+      { "rook ss", &sq_score_scaling[rook] },
+      { "queen ss", &sq_score_scaling[queen] },
+      { "king ss", &sq_score_scaling[king] },
+      { "knight ms", &mobility_scaling[knight] },
+      { "bishop ms", &mobility_scaling[bishop] },
+      { "rook ms", &mobility_scaling[rook] },
+      { "queen ms", &mobility_scaling[queen] },
+      { "knight as", &attack_scaling[knight] },
+      { "bishop as", &attack_scaling[bishop] },
+      { "rook as", &attack_scaling[rook] },
+      { "queen as", &attack_scaling[queen] },
+      { "castle pen", &uncastled_penalty },
+      { "knight ak", &attacker_weight[knight] },
+      { "bishop ak", &attacker_weight[bishop] },
+      { "rook ak", &attacker_weight[rook] },
+      { "queen ak", &attacker_weight[queen] },
+      { "bishop pin", &pinned_scaling[bishop] },
+      { "rook pin", &pinned_scaling[rook] },
+      { "queen pin", &pinned_scaling[queen] },
+      { "king s1", &king_safe_sqs[0] },
+      { "king s2", &king_safe_sqs[1] },
+      { "king s3", &king_safe_sqs[2] },
+      { "king s4", &king_safe_sqs[3] },
+      { "king s5", &king_safe_sqs[4] },
+      { "king s6", &king_safe_sqs[5] },
+      { "king s7", &king_safe_sqs[6] },
+      { "king s8", &king_safe_sqs[7] }
+    };
+  }
+
+  // every float key of engine.conf: the tuneables plus the pawn scalings the tuners leave alone
+  std::vector<std::pair<std::string, float*>> conf_values() {
+    auto v = tuneables();
+    v.push_back({ "pawn ms", &mobility_scaling[pawn] });
+    v.push_back({ "pawn as", &attack_scaling[pawn] });
+    v.push_back({ "pawn ak", &attacker_weight[pawn] });
+    return v;
+  }
+
   float tempo = 0.3f;
 
 
@@ -37,14 +37,18 @@ inline size_t pow2(size_t x) {
   return x <= 2 ? x : pow2(x >> 1) << 1;
 }
 
-pawn_table::pawn_table() : sz_mb(0), count(0) {
+pawn_table::pawn_table() : sz_mb(10 * 1024), count(0) {
+  init();
+}
+
+
+pawn_table::pawn_table(const size_t& mb) : sz_mb(mb * 1024), count(0) {
   init();
 }
 
 
 
 void pawn_table::init() {
-  sz_mb = 10 * 1024; // todo : input mb parameter
   count = 1024 * sz_mb / sizeof(pawn_entry);
   count = pow2(count);
   count = (count < 1024 ? 1024 : count);
@@ -146,14 +150,15 @@ int16 evaluate(const position& p, pawn_entry& e) {
     p.get_pieces<white, pawn>() :
     p.get_pieces<black, pawn>();
   
-  Square * sqs = p.squares_of<c, pawn>();
+  U64 sqs = pawns;
 
   Square ksq = p.king_square(c);
 
   int16 score = 0;
   U64 locked_bb = 0ULL;
   
-  for (Square s = *sqs; s != no_square; s = *++sqs) {
+  while (sqs) {
+    const auto s = static_cast<Square>(bits::pop_lsb(sqs));
 
     U64 fbb = bitboards::squares[s];
     int row = util::row(s);
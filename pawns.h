@@ -65,6 +65,7 @@ class pawn_table {
   
  public:
   pawn_table();
+  explicit pawn_table(const size_t& mb);
   pawn_table(const pawn_table& o) = delete;
   pawn_table(const pawn_table&& o) = delete;
   pawn_table& operator=(const pawn_table& o) = delete;
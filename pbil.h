@@ -30,6 +30,8 @@ THE SOFTWARE.
 #include <vector>
 #include <random>
 #include <functional>
+#include <algorithm>
+#include <thread>
 
 #include "threads.h"
 
@@ -41,6 +43,7 @@ class pbil {
   std::vector<std::vector<int>> samples;
   std::vector<int> best_sample, initial_guess;
   std::mt19937 rng;
+  unsigned threads;
 
   void educate();
   void educate(float min, float max);
@@ -63,7 +66,8 @@ class pbil {
       const double& nlr,
       const double& tol) :
    mutate_prob(mutate_p), mutate_shift(mutate_s), best_err(1e10),
-   learn_rate(lr), neg_learn_rate(nlr), etol(tol)
+   learn_rate(lr), neg_learn_rate(nlr), etol(tol),
+   threads(std::max(1u, std::thread::hardware_concurrency()))
   {
     samples =
       std::vector<std::vector<int>>(popsz, std::vector<int>(nbits));
@@ -82,6 +86,8 @@ class pbil {
   template<class T, typename... Args>
   void optimize(T&& residual, Args&&... args);
 
+  void set_threads(const unsigned& n) { threads = std::max(1u, n); }
+
   void set_initial_guess(const std::vector<int>& guess) {
     for (auto& g : guess) initial_guess.push_back(g);
   }
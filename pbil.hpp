@@ -134,12 +134,6 @@ inline void pbil::init() {
 }
 
 
-struct thread_data {
-  unsigned start;
-  unsigned end;
-  std::vector<double> errors;
-};
-
 template<class T, typename... Args>
 void pbil::optimize(T&& residual, Args&&... args) {
   using namespace std::placeholders;
@@ -155,18 +149,9 @@ void pbil::optimize(T&& residual, Args&&... args) {
     std::bind(std::forward<T>(residual),
       _1,
       std::ref(std::forward<Args>(args))...);
-  /*
-  Threadpool workers;
-  std::vector<thread_data> T;
-
-  for (size_t j = 0, chunk = (samples.size() + 1) / workers.size(); j < workers.size(); j += chunk) {
-    thread_data td;
-    td.start = j;
-    td.end = std::min(td.start + chunk, workers.size() - td.start);
-    td.errors(td.end - td.start);
-    T.push_back(td);
-  }
-  */
+
+  // population members are scored concurrently, one task per sample
+  Threadpool workers(static_cast<unsigned>(std::min<size_t>(threads, samples.size())));
 
   while (best_err >= etol) {
     
@@ -181,10 +166,14 @@ void pbil::optimize(T&& residual, Args&&... args) {
 
     int i = 0;
     std::vector<double> errors(samples.size());
-    
-    for (auto& e : errors) { e = rf(samples[i++]); }
-    
-    
+
+    for (size_t j = 0; j < samples.size(); ++j) {
+      workers.enqueue([&rf, &errors, this, j]() { errors[j] = rf(samples[j]); });
+    }
+    workers.wait_finished();
+
+    // errors are indexed by sample, so the min/max scan below (first wins on
+    // ties) picks the same genes regardless of completion order
     double min_err = 1e10;
     double max_err = -1e10;
     std::vector<int> min_sample, max_sample;
@@ -21,6 +21,7 @@ THE SOFTWARE.
 */
 #include "position.h"
 #include "move.h"
+#include "packed.h"
 
 position::position(std::istringstream& fen) { setup(fen); }
 
@@ -28,34 +29,29 @@ position::position(std::istringstream& fen) { setup(fen); }
 position::position(const position& p) { *this = p; }
 
 
+// copies the board and the live part of the repetition stack, the
+// search tables stay bound to whatever p was bound to
 position& position::operator=(const position& p) {
-  std::copy(std::begin(p.history), std::end(p.history), std::begin(history));
+  std::copy(p.history, p.history + p.hidx, history);
   ifo = p.ifo;
   pcs = p.pcs;
   stats = p.stats;
+  counters = p.counters;
+  tree = p.tree;
   hidx = p.hidx;
   thread_id = p.thread_id;
   nodes_searched = p.nodes_searched;
   qnodes_searched = p.qnodes_searched;
   params = p.params;
   debug_search = p.debug_search;
+  hash_tbl = p.hash_tbl;
+  pawn_tbl = p.pawn_tbl;
+  material_tbl = p.material_tbl;
+  sig = p.sig;
   return *(this);
 }
 
 
-piece_data& piece_data::operator=(const piece_data& pd) {
-  std::copy(std::begin(pd.bycolor), std::end(pd.bycolor), std::begin(bycolor));
-  std::copy(std::begin(pd.king_sq), std::end(pd.king_sq), std::begin(king_sq));
-  std::copy(std::begin(pd.color_on), std::end(pd.color_on), std::begin(color_on));
-  std::copy(std::begin(pd.piece_on), std::end(pd.piece_on), std::begin(piece_on));
-  std::copy(std::begin(pd.number_of), std::end(pd.number_of), std::begin(number_of));
-  std::copy(std::begin(pd.bitmap), std::end(pd.bitmap), std::begin(bitmap));
-  std::copy(std::begin(pd.piece_idx), std::end(pd.piece_idx), std::begin(piece_idx));
-  std::copy(std::begin(pd.square_of), std::end(pd.square_of), std::begin(square_of));
-  return (*this);
-}
-
-
 void position::setup(std::istringstream& fen) {
   clear();
   std::string token;
@@ -114,9 +110,76 @@ void position::setup(std::istringstream& fen) {
   ifo.hmvs = (token != "-" ? static_cast<U16>(std::stoi(token)) : 0);
   ifo.key ^= zobrist::hmvs(ifo.hmvs);
 
-  // check info
+  set_check_info();
+}
+
+
+void position::setup(const packed_position& pp) {
+  clear();
+
+  U64 occ = pp.occupied;
+  for (int n = 0; occ && n < 32; ++n) {
+    auto s = static_cast<Square>(bits::pop_lsb(occ));
+    U8 code = (n & 1 ? pp.pieces[n >> 1] >> 4 : pp.pieces[n >> 1] & 15);
+    auto c = static_cast<Color>(code >> 3);
+    auto piece = static_cast<Piece>(code & 7);
+    pcs.set(c, piece, s, ifo);
+    if (piece == king) ifo.ks[c] = s;
+  }
+
+  // keys are built the same way setup(fen) builds them
+  ifo.stm = pp.stm();
+  ifo.key ^= zobrist::stm(ifo.stm);
+  ifo.repkey ^= zobrist::stm(ifo.stm);
+
+  ifo.cmask = pp.cmask();
+  if (ifo.cmask == 0) {
+    ifo.key ^= zobrist::castle(ifo.stm, 0);
+    ifo.repkey ^= zobrist::castle(ifo.stm, 0);
+  }
+  for (U16 cr : { wks, wqs, bks, bqs }) {
+    if ((ifo.cmask & cr) == 0) continue;
+    ifo.key ^= zobrist::castle(ifo.stm, cr);
+    ifo.repkey ^= zobrist::castle(ifo.stm, cr);
+  }
+
+  ifo.eps = (util::on_board(pp.eps) ? static_cast<Square>(pp.eps) : no_square);
+  if (ifo.eps != no_square) {
+    ifo.key ^= zobrist::ep(util::col(ifo.eps));
+    ifo.repkey ^= zobrist::ep(util::col(ifo.eps));
+  }
+
+  ifo.move50 = pp.move50;
+  ifo.key ^= zobrist::mv50(ifo.move50);
+  ifo.hmvs = pp.hmvs;
+  ifo.key ^= zobrist::hmvs(ifo.hmvs);
+
+  set_check_info();
+}
+
+
+void position::pack(packed_position& pp) const {
+  std::memset(&pp, 0, sizeof(packed_position));
+
+  U64 occ = all_pieces();
+  pp.occupied = occ;
+  for (int n = 0; occ && n < 32; ++n) {
+    auto s = static_cast<Square>(bits::pop_lsb(occ));
+    auto code = static_cast<U8>((color_on(s) << 3) | piece_on(s));
+    pp.pieces[n >> 1] |= (n & 1 ? code << 4 : code);
+  }
+
+  pp.score = packed_no_score;
+  pp.result = pgn_none;
+  pp.flags = static_cast<U8>(ifo.stm | (ifo.cmask << 1));
+  pp.eps = static_cast<U8>(ifo.eps);
+  pp.move50 = ifo.move50;
+  pp.hmvs = ifo.hmvs;
+}
+
+
+void position::set_check_info() {
   Color stm = to_move();
-  ifo.ks[stm] = pcs.king_sq[stm];  
   ifo.incheck = is_attacked(ifo.ks[stm], stm, static_cast<Color>(stm ^ 1));
   
   ifo.checkers = (in_check() ? attackers_of2(ifo.ks[stm], static_cast<Color>(stm ^ 1)) : 0ULL);
@@ -201,7 +264,6 @@ void position::do_move(const Move& m) {
 
   // king square update and castle rights update
   if (p == king) {
-    pcs.king_sq[us] = to;
     ifo.ks[us] = to;
     if (can_castle_ks() || can_castle_qs()) {
       //(us == white && can_castle<white>()) ||
@@ -316,41 +378,42 @@ void position::undo_move(const Move& m) {
   const auto us = static_cast<Color>(to_move() ^ 1);
   Piece cp = ifo.captured;
   
-  if (t == quiet) pcs.do_quiet(us, p, from, to, ifo);
+  // board only, the keys come back with the saved info
+  if (t == quiet) pcs.move(us, p, from, to);
 
   else if (t == capture) {
-    pcs.do_quiet(us, p, from, to, ifo);
-    pcs.add_piece(to_move(), cp, from, ifo);
+    pcs.move(us, p, from, to);
+    pcs.add(to_move(), cp, from);
   }
 
   else if (t == ep) {
-    pcs.do_quiet(us, p, from, to, ifo);
-    pcs.add_piece(to_move(), cp, static_cast<Square>(from + (us == white ? -8 : 8)), ifo);
+    pcs.move(us, p, from, to);
+    pcs.add(to_move(), cp, static_cast<Square>(from + (us == white ? -8 : 8)));
   }
   
   else if (t < capture_promotion_q) {
-    pcs.remove_piece(us, piece_on(from), from, ifo);
-    pcs.add_piece(us, pawn, to, ifo);
+    pcs.remove(us, piece_on(from), from);
+    pcs.add(us, pawn, to);
   }
   
   else if (t < castle_ks) {
-    pcs.remove_piece(us, piece_on(from), from, ifo);
-    pcs.add_piece(to_move(), cp, from, ifo);
-    pcs.add_piece(us, pawn, to, ifo);
+    pcs.remove(us, piece_on(from), from);
+    pcs.add(to_move(), cp, from);
+    pcs.add(us, pawn, to);
   }
 
   else if (t == castle_ks) {
     Square rt = (us == white ? H1 : H8);
     Square rf = (us == white ? F1 : F8);
-    pcs.do_quiet(us, king, from, to, ifo);
-    pcs.do_quiet(us, rook, rf, rt, ifo);
+    pcs.move(us, king, from, to);
+    pcs.move(us, rook, rf, rt);
   }
 
   else if (t == castle_qs) {
     Square rf = (us == white ? D1 : D8);
     Square rt = (us == white ? A1 : A8);
-    pcs.do_quiet(us, king, from, to, ifo);
-    pcs.do_quiet(us, rook, rf, rt, ifo);
+    pcs.move(us, king, from, to);
+    pcs.move(us, rook, rf, rt);
   }
   ifo = history[--hidx];
 }
@@ -389,172 +452,140 @@ void position::undo_null_move() {
 }
 
 
-int position::see(const Move& m) {
+namespace {
+  // exchange values, the king only ever ends a sequence
+  constexpr int see_vals[] = { 100, 300, 315, 480, 910, 2000, 0, 0 };
 
-  std::vector<int> mvals { 100, 300, 315, 480, 910, 2000 };
-  if (m.type == ep) return 0;
-  if (m.type == capture &&
-	  (mvals[piece_on(static_cast<Square>(m.f))] <= mvals[piece_on(static_cast<Square>(m.t))])) {
-	  return (mvals[piece_on(static_cast<Square>(m.t))] - mvals[piece_on(static_cast<Square>(m.f))]);
-  }
-  if (m.type == capture_promotion_q ||
-	  m.type == capture_promotion_r ||
-	  m.type == capture_promotion_b ||
-	  m.type == capture_promotion_n) {
-	  int fval = (m.type == capture_promotion_q
-		              ? mvals[queen] :
-		              m.type == capture_promotion_r
-		              ? mvals[rook] :
-		              m.type == capture_promotion_b
-		              ? mvals[bishop] :
-		              mvals[knight]) - mvals[0];
-	  int tval = mvals[piece_on(static_cast<Square>(m.t))];
-    
-	  if (fval <= tval) return fval - tval;
+  inline Piece promoted_piece(const Movetype& mt) {
+    switch (mt) {
+    case promotion_q: case capture_promotion_q: return queen;
+    case promotion_r: case capture_promotion_r: return rook;
+    case promotion_b: case capture_promotion_b: return bishop;
+    case promotion_n: case capture_promotion_n: return knight;
+    default: return no_piece;
+    }
   }
+}
 
+// the cheapest piece of color "c" in "atk", its square returned in "bb"
+Piece position::least_attacker(const U64& atk, const Color& c, U64& bb) const {
+  for (int p = pawn; p <= king; ++p) {
+    U64 a = atk & pcs.bitmap[c][p];
+    if (a) {
+      bb = a & (0ULL - a);
+      return static_cast<Piece>(p);
+    }
+  }
+  bb = 0ULL;
+  return no_piece;
+}
+
+// sliders of either color hitting "s" through "occ" (x-rays once a piece has moved off)
+U64 position::slider_attackers(const Square& s, const U64& occ) const {
+  const auto& w = pcs.bitmap[white];
+  const auto& b = pcs.bitmap[black];
+  return (magics::attacks<bishop>(occ, s) & (w[bishop] | w[queen] | b[bishop] | b[queen])) |
+    (magics::attacks<rook>(occ, s) & (w[rook] | w[queen] | b[rook] | b[queen]));
+}
 
+int position::see(const Move& m) {
+  if (m.type == castle_ks || m.type == castle_qs) return 0;
   return see_move(m);
 }
 
+// swap-list exchange evaluation on the to square, pins are ignored
 int position::see_move(const Move& m) {
-  
-  std::vector<int> mvals { 100, 300, 315, 480, 910, 2000 };
-  
-  struct SeePiece {
-    SeePiece(const Piece& pc, const int16& v) : p(pc), score(v) { }
-    Piece p;
-    int16 score;
-    bool operator<(const SeePiece& o) const { return score < o.score; }
-    bool operator>(const SeePiece& o) const { return score > o.score; }
-  };
-  Square bks = king_square(black);
-  Square wks = king_square(white);
-  auto to = static_cast<Square>(m.t);
-  auto from = static_cast<Square>(m.f);
-  U64 pieces = all_pieces();
-  U64 attackers = 0ULL;
-
-  U64 white_bb = get_pieces<white>() ^ pinned<white>();
-  U64 black_bb = get_pieces<black>() ^ pinned<black>();
-
-  std::vector<SeePiece> black_list;
-  std::vector<SeePiece> white_list;
-  Piece atkr = no_piece;
-
-  while (true) { // while loop for pieces behind currently attacking pieces
-    U64 a = attackers_of(to, pieces) & pieces;
-    if (a) {
-      pieces ^= a;
+  const auto f = static_cast<Square>(m.f);
+  const auto t = static_cast<Square>(m.t);
+  const auto mt = static_cast<Movetype>(m.type);
+  U64 occ = all_pieces() ^ bitboards::squares[f];
+  int gain[32];
+  int d = 0;
 
-      if (is_attacked(wks, white, black, pieces) || is_attacked(bks, black, white, pieces))
-      {
-        return 0; // let search handle discovered checking sequences
-      }
+  Piece captured = (mt == ep ? pawn : piece_on(t));
+  if (captured == king) return 0; // illegal
+  gain[0] = (captured == no_piece ? 0 : see_vals[captured]);
+  if (mt == ep) occ ^= bitboards::squares[ifo.stm == white ? t - 8 : t + 8];
 
-      attackers |= a;
-    }
-    else break;
-
-    U64 white_attackers = a & white_bb;
-    if (white_attackers) {
-      while (white_attackers) {
-	      auto s = static_cast<Square>(bits::pop_lsb(white_attackers));
-        if (s == from) {
-          atkr = piece_on(s);
-          continue; // first attacker is handled below
-        }
-        white_list.emplace_back(SeePiece(piece_on(s), mvals[piece_on(s)]));
-      }
-    }
-    
-    U64 black_attackers = a & black_bb;
-    if (black_attackers) {
-      while (black_attackers) {
-	      auto s = static_cast<Square>(bits::pop_lsb(black_attackers));
-        if (s == from) {
-          atkr = piece_on(s);
-          continue;
-        }
-        black_list.emplace_back(SeePiece(piece_on(s), mvals[piece_on(s)]));
-      }
-    }
-    
-    if (white_list.empty() && black_list.empty() && atkr == no_piece) return 0;
+  Piece on_square = piece_on(f);
+  const Piece promoted = promoted_piece(mt);
+  if (promoted != no_piece) {
+    gain[0] += see_vals[promoted] - see_vals[pawn];
+    on_square = promoted;
   }
-  
-  std::sort(white_list.begin(), white_list.end());
-  std::sort(black_list.begin(), black_list.end());
-  
-  
-  int i = 0;
-  unsigned w = 0;
-  unsigned b = 0;
-  Color color = to_move();
 
-    
-  if (color == black) { black_list.insert(black_list.begin(), SeePiece(atkr, 0)); }
-  else { white_list.insert(white_list.begin(), SeePiece(atkr, 0)); }
-
-  int score = 0;
-  int prev = score;
-
-  while(true) {
-	  if (i == 0) {
-      Piece v = piece_on(to);
-      if (v == king) return 0; // illegal
-      score += (v == no_piece ? 0 : mvals[v]);
-      color = static_cast<Color>(color ^ 1);
-      prev = score;
-      ++i;
-      continue;
-    }
+  U64 atk = attackers_of(t, occ) & occ;
+  auto side = static_cast<Color>(ifo.stm ^ 1);
 
-    if ((w >= white_list.size() || b >= black_list.size())) break;
+  while (d < 31) {
+    U64 bb = 0ULL;
+    const Piece p = least_attacker(atk, side, bb);
+    if (p == no_piece) break;
 
-    Piece victim = (color == white ? black_list[b++].p : white_list[w++].p);
+    // the king can only take back an undefended piece
+    if (p == king && (atk & pcs.bycolor[side ^ 1])) break;
 
-    int av = -1;
-    Piece attacker = no_piece;
-    if (color == white && w < white_list.size()) {
-      attacker = white_list[w].p;
-      av = mvals[attacker];
-    }
-    else if (color == black && b < black_list.size()) {
-      attacker = black_list[b].p;
-      av = mvals[attacker];
-    }
+    ++d;
+    gain[d] = see_vals[on_square] - gain[d - 1];
 
-    if (attacker == no_piece) break;
+    on_square = p;
+    occ ^= bb;
+    atk = (atk | slider_attackers(t, occ)) & occ;
+    side = static_cast<Color>(side ^ 1);
+  }
 
-    
-    color = static_cast<Color>(color ^ 1);
-    int vv = mvals[victim];
+  while (d > 0) {
+    gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+    --d;
+  }
+  return gain[0];
+}
 
+// true when the exchange started by "m" nets at least "threshold",
+// stopping as soon as the side to recapture can no longer change the outcome
+bool position::see_ge(const Move& m, const int& threshold) {
+  const auto mt = static_cast<Movetype>(m.type);
+  if (mt == castle_ks || mt == castle_qs) return threshold <= 0;
 
+  const auto f = static_cast<Square>(m.f);
+  const auto t = static_cast<Square>(m.t);
+  U64 occ = all_pieces() ^ bitboards::squares[f];
 
-    if (vv < av || victim == king) {
-      if (attacker == king) {
-        if ((color == black && b < black_list.size()) ||
-          (color == white && w < white_list.size())) {
-          return score; // illegal
-        }
-      }
-      
-      
-      if ((victim == king && ((color == black && w < white_list.size()) || (color == white && b < black_list.size()))) ||
-        (victim != king && ((color == black && (black_list.size() > white_list.size())) ||
-          (color == white && (white_list.size() > black_list.size()))))) {
-        score = prev;
-        return score;
-      }
-    }
-    score += ((i & 1) == 1 ? -vv : vv);
-    ++i;
-    prev = score;
+  Piece captured = (mt == ep ? pawn : piece_on(t));
+  int swap = (captured == no_piece ? 0 : see_vals[captured]) - threshold;
+  if (mt == ep) occ ^= bitboards::squares[ifo.stm == white ? t - 8 : t + 8];
+
+  Piece on_square = piece_on(f);
+  const Piece promoted = promoted_piece(mt);
+  if (promoted != no_piece) {
+    swap += see_vals[promoted] - see_vals[pawn];
+    on_square = promoted;
   }
-  
-  return score;
+  if (swap < 0) return false;
+
+  swap = see_vals[on_square] - swap;
+  if (swap <= 0) return true;
+
+  U64 atk = attackers_of(t, occ) & occ;
+  Color side = ifo.stm;
+  int res = 1;
+
+  while (true) {
+    side = static_cast<Color>(side ^ 1);
+    U64 bb = 0ULL;
+    const Piece p = least_attacker(atk, side, bb);
+    if (p == no_piece) break;
+
+    res ^= 1;
+    if (p == king) return (atk & pcs.bycolor[side ^ 1]) ? res == 0 : res == 1;
+
+    swap = see_vals[p] - swap;
+    if (swap < res) break;
+
+    occ ^= bb;
+    atk = (atk | slider_attackers(t, occ)) & occ;
+  }
+  return res == 1;
 }
 
 inline bool _is_promotion(const Movetype& mt) {
@@ -698,7 +729,7 @@ bool position::is_legal(const Move& m) {
   Color us = to_move();
 	auto them = static_cast<Color>(us ^ 1);
   Square eks = king_square(them);
-  auto pc = pcs.bitmap[them];
+  const auto& pc = pcs.bitmap[them];
   bool ispromotion = is_promotion(mt);
   bool iscappromotion = is_cap_promotion(mt);
 
@@ -805,7 +836,7 @@ bool position::in_check() const {
 
 bool position::is_attacked(const Square& s, const Color& us, const Color& them, U64 m) {
   // is square owned by "us" attacked by "them"
-  auto p = pcs.bitmap[them];  
+  const auto& p = pcs.bitmap[them];
   U64 stepper_attacks = ((bitboards::pattks[us][s] & p[pawn]) |
 			 (bitboards::nmask[s] & p[knight]) |
 			 (bitboards::kmask[s] & p[king]));
@@ -818,7 +849,7 @@ bool position::is_attacked(const Square& s, const Color& us, const Color& them,
 	   (magics::attacks<rook>(m, s) & (p[queen] | p[rook]))));
 }
 
-U64 position::attackers_of(const Square& s, const U64& bb) {
+U64 position::attackers_of(const Square& s, const U64& bb) const {
   auto p = [this](const Color& c, const Piece& p) { return pcs.bitmap[c][p]; };
   U64 battck = magics::attacks<bishop>(bb, s);
   U64 rattck = magics::attacks<rook>(bb, s);
@@ -833,10 +864,37 @@ U64 position::attackers_of(const Square& s, const U64& bb) {
 	  (qattck & (p(white, queen) | p(black, queen))));
 }
 
+// quiet moves only: a direct check from the to square, or a slider of ours
+// uncovered on the enemy king by vacating the from square
+bool position::gives_check(const Move& m) const {
+  const Color us = ifo.stm;
+  const auto them = static_cast<Color>(us ^ 1);
+  const auto f = static_cast<Square>(m.f);
+  const auto t = static_cast<Square>(m.t);
+  const Square ks = ifo.ks[them];
+  const U64 occ = (all_pieces() ^ bitboards::squares[f]) | bitboards::squares[t];
+  const auto& ours = pcs.bitmap[us];
+
+  U64 direct = 0ULL;
+  switch (piece_on(f)) {
+  case pawn: direct = bitboards::pattks[us][t]; break;
+  case knight: direct = bitboards::nmask[t]; break;
+  case bishop: direct = magics::attacks<bishop>(occ, t); break;
+  case rook: direct = magics::attacks<rook>(occ, t); break;
+  case queen: direct = magics::attacks<bishop>(occ, t) | magics::attacks<rook>(occ, t); break;
+  default: break;
+  }
+  if (direct & bitboards::squares[ks]) return true;
+
+  const U64 diagonal = (ours[bishop] | ours[queen]) & ~bitboards::squares[f];
+  const U64 straight = (ours[rook] | ours[queen]) & ~bitboards::squares[f];
+  return ((magics::attacks<bishop>(occ, ks) & diagonal) | (magics::attacks<rook>(occ, ks) & straight)) != 0ULL;
+}
+
 U64 position::attackers_of2(const Square& s, const Color& c) const {
   // attackers of square "s" by color "c"
   U64 m = all_pieces();
-  auto p = pcs.bitmap[c];
+  const auto& p = pcs.bitmap[c];
   U64 battck = magics::attacks<bishop>(m, s);
   U64 rattck = magics::attacks<rook>(m, s);
   U64 qattck = battck | rattck;
@@ -861,7 +919,6 @@ void position::set_piece(const char& p, const Square& s) {
 
 void position::clear() {
   pcs.clear();
-  stats.clear();
   hidx = 0;
   thread_id = 0;
   nodes_searched = 0;
@@ -881,10 +938,10 @@ void position::print() const {
     
     for (Col c = A; c <= H; ++c) {
 	    auto s = static_cast<Square>(8 * r + c);
-      if (pcs.piece_on[s] != no_piece) {
-        Piece p = pcs.piece_on[s];
+      if (piece_on(s) != no_piece) {
+        Piece p = piece_on(s);
         std::cout << "| "
-                  << (pcs.color_on[s] == white ? SanPiece[p] : SanPiece[p+6])
+                  << (color_on(s) == white ? SanPiece[p] : SanPiece[p+6])
                   << " ";
       }
       else std::cout << "|   ";	
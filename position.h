@@ -43,6 +43,18 @@ THE SOFTWARE.
 #include "parameter.h" // just for parameter reference (todo: refactor)
 
 struct Move;
+struct packed_position;
+class hash_table;
+class pawn_table;
+class material_table;
+struct signals;
+struct search_stats;
+struct tree_log;
+
+extern hash_table ttable;
+extern pawn_table ptable;
+extern material_table mtable;
+extern signals UCI_SIGNALS;
 
 
 struct info {
@@ -64,35 +76,41 @@ struct info {
 };
 
 
-struct piece_data {  
-  
-  std::array<U64, 2> bycolor;
-  std::array<Square, 2> king_sq;
-  std::array<Color, squares> color_on;
-  std::array<Piece, squares> piece_on;
-  std::array<std::array<int, pieces>, 2> number_of;
-  std::array<std::array<U64, squares>, colors> bitmap;
-  std::array<std::array<std::array<int, squares>, pieces>, 2> piece_idx;
-  std::array<std::array<std::array<Square, 11>, pieces>, 2> square_of;
-
-  piece_data(): bycolor(), king_sq(), color_on(), piece_on(), number_of(), bitmap(), piece_idx(), square_of()
+// the board core touched by every do/undo: piece bitboards, occupancy by
+// color and a one byte mailbox ((color << 3) | piece), three cache lines in
+// all.  piece counts and piece lists are derived from the bitboards on demand.
+// positions are heap allocated (make_unique), so the 64 byte alignment needs
+// -faligned-new under c++11, see the makefiles
+struct alignas(64) piece_data {
+
+  std::array<std::array<U64, pieces>, colors> bitmap;
+  std::array<U64, colors> bycolor;
+  std::array<U8, squares> mailbox;
+
+  static const U8 empty = (no_color << 3) | no_piece;
+
+  piece_data(): bitmap(), bycolor(), mailbox()
   {
   } ;
-  piece_data(const piece_data& pd);
-  piece_data& operator=(const piece_data& pd);
+
+  Piece on(const Square& s) const { return static_cast<Piece>(mailbox[s] & 7); }
+
+  Color color_on(const Square& s) const { return static_cast<Color>(mailbox[s] >> 3); }
+
+  int number_of(const Color& c, const Piece& p) const { return bits::count(bitmap[c][p]); }
   
   // utility methods for moving pieces
   void clear();
 
   void set(const Color& c, const Piece& p, const Square& s, info& ifo);
-  
-  inline void do_quiet(const Color& c, const Piece& p, const Square& f, const Square& t, info& ifo);
 
-  template<Color c>
-  void do_castle(const bool& kingside);
+  // board only, undo_move restores the keys with the saved info
+  inline void move(const Color& c, const Piece& p, const Square& f, const Square& t);
+  inline void add(const Color& c, const Piece& p, const Square& s);
+  inline void remove(const Color& c, const Piece& p, const Square& s);
   
-  template<Color c>
-  void undo_castle(const bool& kingside);
+  // board and incremental key updates for do_move
+  inline void do_quiet(const Color& c, const Piece& p, const Square& f, const Square& t, info& ifo);
 
   inline void do_cap(const Color& c, const Piece& p, const Square& f, const Square& t, info& ifo);
   
@@ -117,12 +135,22 @@ struct piece_data {
 class position {  
   U16 thread_id{};
   info history[512]{};
-  move_history stats;
+  move_history * stats = nullptr; // per-thread search tables, bound by Search::start
+  search_stats * counters = nullptr; // per-thread search counters, bound by Search::start
+  tree_log * tree = nullptr; // per-thread tree log while 'treelog on', else null
   info ifo{};
   piece_data pcs;
   U64 hidx{};
   U64 nodes_searched{};
   U64 qnodes_searched{};
+  hash_table * hash_tbl = &ttable;
+  pawn_table * pawn_tbl = &ptable;
+  material_table * material_tbl = &mtable;
+  signals * sig = &UCI_SIGNALS;
+
+  void set_check_info();
+  Piece least_attacker(const U64& atk, const Color& c, U64& bb) const;
+  U64 slider_attackers(const Square& s, const U64& occ) const;
   
  public:
   position(): thread_id(0), history{}, ifo(), hidx(0), nodes_searched(0), qnodes_searched(0), elapsed_ms(0)
@@ -140,11 +168,16 @@ class position {
 
   double elapsed_ms{};
   std::string bestmove;
+  std::string bestline; // pv of the last search, uci moves
+  Score bestscore{};
+  U16 bestdepth{}; // last completed iteration
   parameters params; // reference to our tuneable parameters
   bool debug_search = false;
 
   // setup/clear a position
   void setup(std::istringstream& fen);
+  void setup(const packed_position& pp);
+  void pack(packed_position& pp) const;
   std::string to_fen();
   void clear();
   void set_piece(const char& p, const Square& s);
@@ -155,21 +188,39 @@ class position {
   void undo_null_move();
   int see_move(const Move& m);
   int see(const Move& m);
+  bool see_ge(const Move& m, const int& threshold);
+  bool gives_check(const Move& m) const;
 
   void stats_update(const Move& m,
                     const Move& previous, 
+                    const Move& followup,
                     const int16& depth,
                     const Score& score,
                     const std::vector<Move>& quiets,
+                    const std::vector<Move>& captures,
                     Move * killers) {
-    stats.update(*this, m, previous, depth, score, quiets, killers);
+    stats->update(*this, m, previous, followup, depth, score, quiets, captures, killers);
   }
-  move_history& history_stats() { return stats; }
+  move_history& history_stats() { return *stats; }
+  void set_history(move_history * h) { stats = h; }
+  search_stats& search_counters() const { return *counters; }
+  void set_counters(search_stats * c) { counters = c; }
+  tree_log * search_tree() const { return tree; }
+  void set_search_tree(tree_log * t) { tree = t; }
+
+  // hash tables and stop signals (the globals unless a worker binds its own)
+  void set_eval_tables(pawn_table * pt, material_table * mt) { pawn_tbl = pt; material_tbl = mt; }
+  void set_hash_table(hash_table * tt) { hash_tbl = tt; }
+  void set_signals(signals * s) { sig = s; }
+  hash_table& tt() const { return *hash_tbl; }
+  pawn_table& pawns() const { return *pawn_tbl; }
+  material_table& material() const { return *material_tbl; }
+  signals& sigs() const { return *sig; }
 
   // utilities
   bool is_attacked(const Square& s, const Color& us, const Color& them, U64 m = 0ULL);
   U64 attackers_of2(const Square& s, const Color& c) const;
-  U64 attackers_of(const Square& s, const U64& bb);
+  U64 attackers_of(const Square& s, const U64& bb) const;
   U64 checkers() const { return ifo.checkers; }
   bool in_check() const;
   bool is_legal(const Move& m);
@@ -241,15 +292,15 @@ class position {
   // piece access wrappers
   U64 all_pieces() const { return pcs.bycolor[white] | pcs.bycolor[black]; }
 
-  unsigned number_of(const Color& c, const Piece& p) const { return pcs.number_of[c][p]; }
+  unsigned number_of(const Color& c, const Piece& p) const { return pcs.number_of(c, p); }
 
-  Piece piece_on(const Square& s) const { return pcs.piece_on[s]; }
+  Piece piece_on(const Square& s) const { return pcs.on(s); }
 
   Square king_square(const Color& c) const { return ifo.ks[c]; }
 
   Square king_square() const { return ifo.ks[ifo.stm]; }
 
-  Color color_on(const Square& s) { return pcs.color_on[s]; }
+  Color color_on(const Square& s) const { return pcs.color_on(s); }
 
   U16 id() const { return thread_id; }
 
@@ -273,45 +324,38 @@ class position {
   template<Color c>
   U64 get_pieces() const { return pcs.bycolor[c]; }
 
-  template<Color c, Piece p>
-  Square * squares_of() const {
-    return const_cast<Square*>(pcs.square_of[c][p].data()+1);
-  }
-  
 };
 
 
 inline void piece_data::clear() {
-  std::fill(bycolor.begin(), bycolor.end(), 0);
-  std::fill(king_sq.begin(), king_sq.end(), no_square);
-  std::fill(color_on.begin(), color_on.end(), no_color);
-  std::fill(piece_on.begin(), piece_on.end(), no_piece);
-
-  for (auto& v: number_of) std::fill(v.begin(), v.end(), 0);
   for (auto& v : bitmap) std::fill(v.begin(), v.end(), 0ULL);
-  for (auto& v: piece_idx) { for (auto& w : v) { std::fill(w.begin(), w.end(), 0); } }
-  for (auto& v: square_of) { for (auto& w : v) { std::fill(w.begin(), w.end(), no_square); } }
+  std::fill(bycolor.begin(), bycolor.end(), 0ULL);
+  std::fill(mailbox.begin(), mailbox.end(), static_cast<U8>(empty));
 }
 
-inline void piece_data::do_quiet(const Color& c, const Piece& p,
-				 const Square& f, const Square& t, info& ifo) {
-
-  // bitmaps
+inline void piece_data::move(const Color& c, const Piece& p, const Square& f, const Square& t) {
   U64 fto = bitboards::squares[f] | bitboards::squares[t];
-
-  int idx = piece_idx[c][p][f];
-  piece_idx[c][p][f] = 0;
-  piece_idx[c][p][t] = idx;
-  
   bycolor[c] ^= fto;
   bitmap[c][p] ^= fto;
-  
-  square_of[c][p][idx] = t;
-  color_on[f] = no_color;
-  color_on[t] = c;
+  mailbox[t] = mailbox[f];
+  mailbox[f] = empty;
+}
+
+inline void piece_data::add(const Color& c, const Piece& p, const Square& s) {
+  bycolor[c] |= bitboards::squares[s];
+  bitmap[c][p] |= bitboards::squares[s];
+  mailbox[s] = static_cast<U8>((c << 3) | p);
+}
+
+inline void piece_data::remove(const Color& c, const Piece& p, const Square& s) {
+  bycolor[c] ^= bitboards::squares[s];
+  bitmap[c][p] ^= bitboards::squares[s];
+  mailbox[s] = empty;
+}
 
-  piece_on[t] = p;
-  piece_on[f] = no_piece;
+inline void piece_data::do_quiet(const Color& c, const Piece& p,
+				 const Square& f, const Square& t, info& ifo) {
+  move(c, p, f, t);
   
   ifo.key = ifo.key ^ zobrist::piece(f, c, p);
   ifo.key = ifo.key ^ zobrist::piece(t, c, p);
@@ -328,8 +372,7 @@ inline void piece_data::do_quiet(const Color& c, const Piece& p,
 inline void piece_data::do_cap(const Color& c, const Piece& p,
 			       const Square& f, const Square& t, info& ifo) {
 	auto them = static_cast<Color>(c ^ 1);
-  Piece cap = piece_on[t];
-  remove_piece(them, cap, t, ifo);
+  remove_piece(them, on(t), t, ifo);
   do_quiet(c, p, f, t, ifo);
 }
 
@@ -349,8 +392,7 @@ inline void piece_data::do_ep(const Color& c, const Square& f, const Square& t,
 inline void piece_data::do_promotion_cap(const Color& c, const Piece& p,
 					 const Square& f, const Square& t, info& ifo) {
 	auto them = static_cast<Color>(c ^ 1);
-  Piece cap = piece_on[t];
-  remove_piece(them, cap, t, ifo);
+  remove_piece(them, on(t), t, ifo);
   remove_piece(c, pawn, f, ifo);
   add_piece(c, p, t, ifo);
 }
@@ -372,22 +414,7 @@ inline void piece_data::do_castle_qs(const Color& c, const Square& f, const Squa
 }
 
 inline void piece_data::remove_piece(const Color& c, const Piece& p, const Square& s, info& ifo) {
-  U64 sq = bitboards::squares[s];
-  bycolor[c] ^= sq;
-  bitmap[c][p] ^= sq;
-
-  // carefully remove this piece so when we add it back in undo, we
-  // do not overwrite an existing piece index
-  int tmp_idx = piece_idx[c][p][s];
-  int max_idx = number_of[c][p];
-  Square tmp_sq = square_of[c][p][max_idx];
-  square_of[c][p][tmp_idx] = square_of[c][p][max_idx];
-  square_of[c][p][max_idx] = no_square;
-  piece_idx[c][p][tmp_sq] = tmp_idx;
-  number_of[c][p] -= 1;
-  piece_idx[c][p][s] = 0;
-  color_on[s] = no_color;
-  piece_on[s] = no_piece;
+  remove(c, p, s);
   ifo.key ^= zobrist::piece(s, c, p);
   ifo.mkey ^= zobrist::piece(s, c, p);
   ifo.repkey ^= zobrist::piece(s, c, p);
@@ -395,15 +422,7 @@ inline void piece_data::remove_piece(const Color& c, const Piece& p, const Squar
 }
 
 inline void piece_data::add_piece(const Color& c, const Piece& p, const Square& s, info& ifo) {  
-  U64 sq = bitboards::squares[s];
-  bycolor[c] |= sq;
-  bitmap[c][p] |= sq;
-  
-  number_of[c][p] += 1;
-  square_of[c][p][number_of[c][p]] = s;
-  piece_on[s] = p;
-  piece_idx[c][p][s] = number_of[c][p];
-  color_on[s] = c;
+  add(c, p, s);
   ifo.key ^= zobrist::piece(s, c, p);
   ifo.mkey ^= zobrist::piece(s, c, p);
   ifo.repkey ^= zobrist::piece(s, c, p);
@@ -411,19 +430,7 @@ inline void piece_data::add_piece(const Color& c, const Piece& p, const Square&
 }
 
 inline void piece_data::set(const Color& c, const Piece& p, const Square& s, info& ifo) {
-  bitmap[c][p] |= bitboards::squares[s];
-  bycolor[c] |= bitboards::squares[s];
-  color_on[s] = c;
-  number_of[c][p] += 1;
-  piece_idx[c][p][s] = number_of[c][p];
-  square_of[c][p][number_of[c][p]] = s;
-  piece_on[s] = p;
-  if (p == king) king_sq[c] = s;
-
-  ifo.key ^= zobrist::piece(s, c, p);
-  ifo.mkey ^= zobrist::piece(s, c, p);
-  ifo.repkey ^= zobrist::piece(s, c, p);
-  if (p == pawn) ifo.pawnkey ^= zobrist::piece(s, c, p);
+  add_piece(c, p, s, ifo);
 }
 
 #endif
@@ -23,10 +23,15 @@ THE SOFTWARE.
 #define SEARCH_H
 
 #include <algorithm>
+#include <vector>
 
 #include "types.h"
 #include "threads.h"
 #include "move.h"
+#include "position.h"
+#include "stats.h"
+#include "trace.h"
+#include "treelog.h"
 #include "uci.h"
 
 
@@ -35,23 +40,101 @@ namespace Search {
   
   std::atomic_bool searching;  
   std::mutex mtx;
-  Move bestmoves[2];
+  search_stats last_stats; // all threads of the last start(), see the stats command
+  std::vector<U64> last_thread_nodes; // per thread of the last start(), master first
+
+  // results of one start() call, shared by its threads
+  struct context {
+    Move bestmoves[2];
+    std::vector<Move> pv; // master's best line
+    Score bestscore;
+    U16 mate_plies; // go mate: target length in plies, 0 = off
+    U16 depth;      // last iteration the master completed
+    unsigned multipv;
+    volatile bool running;
+  };
+
+  // a legal root move with what the last iterations learned about it
+  struct root_move {
+    Move move;
+    Score score;          // this iteration, ninf unless it raised alpha
+    Score previous_score; // last iteration
+    U64 nodes;            // subtree size this iteration
+    std::vector<Move> pv;
+  };
+
+  // the root moves of one search thread.  searched in list order, re-sorted
+  // after every root search by score, then previous score, then subtree
+  // size.  multipv line k searches the moves from pv_index = k onwards
+  class root_move_list {
+    std::vector<root_move> moves;
+
+  public:
+    unsigned pv_index = 0;
+
+    explicit root_move_list(position& p);
+
+    size_t size() const { return moves.size(); }
+    root_move& operator[](const size_t& i) { return moves[i]; }
+    const root_move& operator[](const size_t& i) const { return moves[i]; }
+
+    root_move * find(const Move& m) {
+      auto it = std::find_if(moves.begin(), moves.end(), [&m](const root_move& r) { return r.move == m; });
+      return (it != moves.end() ? &(*it) : nullptr);
+    }
+
+    void new_iteration() {
+      for (auto& r : moves) {
+        r.previous_score = r.score;
+        r.score = ninf;
+        r.nodes = 0;
+      }
+    }
+
+    void sort(const size_t& first) {
+      std::stable_sort(moves.begin() + std::min(first, moves.size()), moves.end(), [](const root_move& a, const root_move& b) {
+        if (a.score != b.score) return a.score > b.score;
+        if (a.previous_score != b.previous_score) return a.previous_score > b.previous_score;
+        return a.nodes > b.nodes;
+      });
+    }
+
+    // share of this iteration's root nodes spent below the first move
+    double best_fraction() const {
+      U64 total = 0;
+      for (const auto& r : moves) total += r.nodes;
+      return (total > 0 && !moves.empty() ? static_cast<double>(moves[0].nodes) / total : 0);
+    }
+  };
   
   struct node {
     U16 ply;
     bool in_check, null_search, gen_checks;
     Move curr_move, best_move, threat_move;
+    Move excluded_move; // singular verification search skips this move
     Move deferred_moves[218];
     Move killers[4];
     Score static_eval;
+    root_move_list * root_moves; // root only
+    Move pv[64];                 // triangular pv: best line from this node down
+    U16 pv_length;
+  };
+
+  // one search thread's board, history tables, counters and tree log.  allocated by the
+  // first search of a calling thread and reused by every later one, so a go
+  // only copies the board in and clears the tables
+  struct thread_state {
+    position board;
+    move_history history;
+    search_stats counters;
+    tree_log tree;
   };
 
-  void search_timer(position& p, limits& lims);
   void start(position& p, limits& lims, bool silent);
-  void iterative_deepening(position& p, U16 depth, bool silent);
-  void readout_pv(position& p, const Score& eval, const U16& depth);
-  void get_bestmove(position& p);
-  double estimate_max_time(position& p, limits& lims);
+  void set_time_limits(position& p, limits& lims);
+  void iterative_deepening(position& p, context& ctx, U16 depth, bool silent);
+  // bound: "" for an exact score, "lowerbound"/"upperbound" after an aspiration fail high/low
+  void print_pv(const root_move& line, const unsigned& index, const unsigned& lines, const U16& depth, const char * bound = "");
 
   template<Nodetype type>
   Score search(position& p, int16 alpha, int16 beta, U16 depth, node * stack);
@@ -53,13 +53,10 @@ struct search_bounds {
 };
 
 std::ofstream debug_file;
-volatile bool slaves_start;
-std::condition_variable cv;
 search_bounds sb;
 unsigned thread_depth = 600;
-volatile double elapsed = 0;
-unsigned prob_cut_tries = 0;
-unsigned prob_cut_successes = 0;
+std::atomic<unsigned> prob_cut_tries{ 0 };
+std::atomic<unsigned> prob_cut_successes{ 0 };
 
 struct move_entry {
   //size_t keyj
@@ -96,6 +93,20 @@ inline unsigned reduction(bool pv_node, bool improving, int d, int mc) {
     [std::max(0, std::min(d, 64 - 1))][std::max(0, std::min(mc, 64 - 1))];
 }
 
+// a move raised alpha at a pv node: its line is the move followed by the child's line
+inline void update_pv(Search::node * stack, const Move& m) {
+  const U16 n = std::min((stack + 1)->pv_length, static_cast<U16>(63));
+  stack->pv[0] = m;
+  std::copy((stack + 1)->pv, (stack + 1)->pv + n, stack->pv + 1);
+  stack->pv_length = n + 1;
+}
+
+// one tree log record, when this thread logs
+inline void log_tree(position& p, const tree_event& ev, const Search::node * stack, const int& depth,
+		     const int& alpha, const int& beta, const int& score, const Move& m) {
+  if (p.search_tree()) p.search_tree()->add(p.key(), ev, stack->ply, depth, alpha, beta, score, m);
+}
+
 inline float razor_margin(int depth) {
   return 950 * (1 - exp((depth - 64.0) / 20.0));
 }
@@ -107,14 +118,21 @@ inline float lazy_eval_margin(int depth, bool advanced_pawn) { //, bool pv_node,
 
 inline void Search::start(position& p, limits& lims, bool silent) {
 
-  std::vector<std::unique_ptr<position>> pv;
-  Threadpool search_threads(4);
-  Threadpool timer_thread(1);
-
-  slaves_start = false;
-  bool parallel = false;
-  elapsed = 0;
-  UCI_SIGNALS.stop = false;
+  trace::scope go("go");
+  context ctx{};
+  // one pool per calling thread, so concurrent callers (match, analyze) each
+  // get their own.  grown, never shrunk, to the largest thread count asked for
+  thread_local std::unique_ptr<Threadpool> search_threads;
+  thread_local std::vector<std::unique_ptr<thread_state>> states;
+  std::vector<position*> pv;
+  signals& sig = p.sigs();
+
+  const unsigned helpers = lims.threads > 1 ? lims.threads - 1 : 0;
+  if (!search_threads || search_threads->size() < helpers + 1) {
+    search_threads = util::make_unique<Threadpool>(helpers + 1);
+  }
+  const bool parallel = helpers > 0;
+  p.tt().new_search();
 
   { // debug stats
     prob_cut_tries = 0;
@@ -125,124 +143,152 @@ inline void Search::start(position& p, limits& lims, bool silent) {
     debug_file.open("debug.txt");
   }
 
-  for (unsigned i = 0; i < search_threads.size(); ++i) {
+  for (unsigned i = 0; i < search_threads->size(); ++i) {
     if (i == 0) { sb.init(); }
-    pv.emplace_back(util::make_unique<position>(p));
+    if (i >= states.size()) states.emplace_back(util::make_unique<thread_state>());
+    states[i]->history.clear();
+    states[i]->board = p;
+    states[i]->board.set_history(&states[i]->history);
+    states[i]->counters.clear();
+    states[i]->board.set_counters(&states[i]->counters);
+    const treelog::settings& tl = treelog::config();
+    if (tl.on) states[i]->tree.reset(tl.max_records, tl.max_ply);
+    states[i]->board.set_search_tree(tl.on ? &states[i]->tree : nullptr);
+    pv.push_back(&states[i]->board);
     pv[i]->set_id(i);
+    pv[i]->set_nodes_searched(0);
+    pv[i]->set_qnodes_searched(0);
   }
 
 
   // launch master
   U16 depth = (lims.depth > 0 ? lims.depth : 64); // maxdepth
   searching = true;
+  ctx.running = true;
+  ctx.bestscore = draw;
+  // the root is ply 1, so a mate in n scores mate - 2n
+  ctx.mate_plies = (lims.mate > 0 ? static_cast<U16>(2 * lims.mate) : 0);
+  ctx.multipv = std::max(lims.multipv, 1u);
+  set_time_limits(p, lims);
+  sig.budget.start(lims.nodes);
+  sig.timer.reset();
+
+  search_threads->enqueue([&]() {
+    iterative_deepening(*pv[0], ctx, depth, silent);
+    ctx.running = false;
+    sig.notify();
+  });
+
+  if (parallel) { // helpers share only the hash table and stop with the master
+    for (unsigned i = 1; i <= helpers; ++i) {
+      search_threads->enqueue(iterative_deepening, *pv[i], ctx, depth, silent);
+    }
+  }
 
-  timer_thread.enqueue(search_timer, p, lims);
-  search_threads.enqueue(iterative_deepening, *pv[0], depth, silent);
-
-  if (parallel) {
-    std::unique_lock<std::mutex> lock(mtx);
-    while (!slaves_start && searching) cv.wait(lock);
-
-    for (unsigned i = 1; i < search_threads.size(); ++i) {
-      if (searching) search_threads.enqueue(iterative_deepening, *pv[i], depth, silent);
+  { // sleep until the master finishes.  a ponderhit re-arms the clock in place
+    // and keeps searching the same tree, a search that ends while pondering
+    // holds its bestmove until the gui sends ponderhit or stop
+    std::unique_lock<std::mutex> lock(sig.m);
+    while (true) {
+      if (sig.ponder_hit && sig.pondering) {
+        trace::instant("ponderhit");
+        sig.ponder_hit = false;
+        sig.pondering = false;
+        lims.ponder = false;
+        set_time_limits(p, lims);
+      }
+      if (!ctx.running && (!sig.pondering || sig.stop)) break;
+      sig.cv.wait(lock);
+      trace::instant("wake");
     }
   }
 
-  search_threads.wait_finished();
-  UCI_SIGNALS.stop = true;
+  sig.stop = true;
+  search_threads->wait_finished();
+  const double elapsed = sig.timer.elapsed_ms();
 
 
   U64 nodes = 0ULL;
   U64 qnodes = 0ULL;
-  for (auto& t : pv) {
-    if (!silent) {
-      std::cout << "id: " << t->id() << " " << t->nodes() << " " << t->qnodes() << std::endl;
+  {
+    std::unique_lock<std::mutex> lock(mtx); // concurrent callers share the last_ results
+    last_stats.clear();
+    last_thread_nodes.clear();
+    for (auto& t : pv) {
+      if (!silent) {
+        std::cout << "id: " << t->id() << " " << t->nodes() << " " << t->qnodes() << std::endl;
+      }
+      nodes += t->nodes();
+      qnodes += t->qnodes();
+      last_stats += states[t->id()]->counters;
+      if (t->id() <= helpers) last_thread_nodes.push_back(t->nodes());
+    }
+    last_stats.elapsed_ms = elapsed;
+
+    if (treelog::config().on) {
+      std::vector<const tree_log*> logs;
+      for (unsigned i = 0; i <= helpers; ++i) logs.push_back(&states[i]->tree);
+      treelog::append(logs);
     }
-    nodes += t->nodes();
-    qnodes += t->qnodes();
   }
 
   if (!silent) {
     std::cout << "time : " << elapsed << "ms" << std::endl;
     std::cout << "nodes: " << nodes << std::endl;
     std::cout << "qnodes: " << qnodes << std::endl;
-    std::cout << "knps: " << (nodes / (elapsed)) << std::endl;
+    std::cout << "knps: " << (nodes / std::max(elapsed, 1e-3)) << std::endl;
     std::cout << "probcut: " << prob_cut_successes << " of " << prob_cut_tries << std::endl;
-    std::cout << "bestmove " << uci::move_to_string(bestmoves[0]) <<
-      " ponder " << uci::move_to_string(bestmoves[1]) << std::endl;
   }
 
   { // record some stats for benching..
-    p.bestmove = uci::move_to_string(bestmoves[0]);
+    p.bestmove = uci::move_to_string(ctx.bestmoves[0]);
+    p.bestline.clear();
+    for (const auto& m : ctx.pv) p.bestline += (p.bestline.empty() ? "" : " ") + uci::move_to_string(m);
+    p.bestscore = ctx.bestscore;
+    p.bestdepth = ctx.depth;
     p.set_nodes_searched(nodes);
     p.set_qnodes_searched(qnodes);
     p.elapsed_ms = elapsed;
   }
 
+  // clear the flag first, a gui may answer bestmove with the next go at once
   searching = false;
 
+  if (!silent) {
+    const bool has_ponder = ctx.bestmoves[1].type != no_type && ctx.bestmoves[1].f != ctx.bestmoves[1].t;
+    std::cout << "bestmove " << uci::move_to_string(ctx.bestmoves[0]) <<
+      (has_ponder ? " ponder " + uci::move_to_string(ctx.bestmoves[1]) : std::string()) << std::endl;
+  }
+
   if (p.debug_search) {
     debug_file.close();
   }
 
 }
 
-inline void Search::search_timer(position& p, limits& lims) {
-  util::clock c;
-  c.start();
-  bool fixed_time = lims.movetime > 0;
-  int delay = 1; // ms
-  double time_limit = estimate_max_time(p, lims);
-  auto sleep = [delay]() { std::this_thread::sleep_for(std::chrono::milliseconds(delay)); };
-
-  if (fixed_time) {
-    do {
-      elapsed += c.elapsed_ms();
-      sleep();
-    } while (!UCI_SIGNALS.stop && searching && elapsed <= lims.movetime);
+// arms the search clock: no limit for infinite, ponder and fixed depth searches,
+// exactly movetime for go movetime, otherwise an adaptive budget from the clock
+inline void Search::set_time_limits(position& p, limits& lims) {
+  if (lims.infinite || lims.ponder || lims.depth > 0) {
+    p.sigs().timer.start(-1, -1);
+    return;
   }
-  else if (time_limit > -1) {
-    // dynamic time estimate in a real game
-    do {
-      elapsed += c.elapsed_ms();
-      sleep();
-    } while (!UCI_SIGNALS.stop && searching && elapsed <= time_limit);
+  if (lims.movetime > 0) {
+    p.sigs().timer.start(lims.movetime, lims.movetime);
+    return;
   }
-  else {
-    do {
-      // analysis mode (infinite time)
-      elapsed += c.elapsed_ms();
-      sleep();
-    } while (!UCI_SIGNALS.stop && searching);
+  const bool white_moves = p.to_move() == white;
+  const double remaining = (white_moves ? lims.wtime : lims.btime);
+  const double inc = (white_moves ? lims.winc : lims.binc);
+  if (remaining <= 0 && inc <= 0) {
+    p.sigs().timer.start(-1, -1);
+    return;
   }
-  UCI_SIGNALS.stop = true;
-  return;
+  p.sigs().timer.start(remaining, inc, lims.movestogo, bits::count(p.all_pieces()));
 }
 
-inline double Search::estimate_max_time(position& p, limits& lims) {
-  double time_per_move_ms = 0;
-  if (lims.infinite || lims.ponder || lims.depth > 0) return -1;
-  bool sudden_death = lims.movestogo == 0; // no moves until next time control
-  bool exact_time = lims.movetime != 0; // searching for an exact number of ms?
-  double remainder_ms = (p.to_move() == white ? lims.wtime + lims.winc : lims.btime + lims.binc);
-  //material_entry * me = mtable.fetch(p);
-  //bool endgame = me->endgame;
-  double moves_to_go = 45.0 - 22.5; // (!endgame ? 22.5 : 30.0);
-
-  if (sudden_death && !exact_time) {
-	  time_per_move_ms = 2.5 * remainder_ms / moves_to_go;
-  }
-  else if (exact_time) return lims.movetime;
-  else if (!sudden_death) {
-	  time_per_move_ms = remainder_ms / lims.movestogo;
-  }
-  return time_per_move_ms;
-}
-
-inline void Search::iterative_deepening(position& p, U16 depth, bool silent) {
-  int16 alpha = ninf;
-  int16 beta = inf;
-  int16 delta = 65;
+inline void Search::iterative_deepening(position& p, context& ctx, U16 depth, bool silent) {
+  trace::scope thread_search("iterative deepening", "thread", p.id());
   Score eval = ninf;
 
 
@@ -255,42 +301,100 @@ inline void Search::iterative_deepening(position& p, U16 depth, bool silent) {
   node stack[stack_size];
   std::memset(stack, 0, sizeof(node) * stack_size);
 
+  root_move_list rml(p);
+  node * root_node = stack + 2;
+  root_node->root_moves = &rml;
+
+  // multipv: line k searches the root moves from index k on, each line keeps
+  // its own aspiration width across iterations
+  const unsigned lines = static_cast<unsigned>(std::max(static_cast<size_t>(1), std::min(static_cast<size_t>(std::max(ctx.multipv, 1u)), rml.size())));
+  std::vector<int16> deltas(lines, 65);
+
   for (unsigned id = 1 + p.id(); id <= depth; ++id) {
     //for (unsigned id = 1; id <= depth; ++id) {
 
-    if (UCI_SIGNALS.stop) break;
+    if (p.sigs().stop || rml.size() == 0) break;
+    trace::scope iteration("iteration", "depth", id);
 
     stack->ply = (stack + 1)->ply = 0;
+    unsigned fail_lows = 0;
+    double best_fraction = 0;
+    bool exact = false;
+    rml.new_iteration();
+
+    for (unsigned k = 0; k < lines && !p.sigs().stop; ++k) {
+      rml.pv_index = k;
+      int16& delta = deltas[k];
+      Score center = rml[k].previous_score;
+
+      while (true) {
+        int16 alpha = ninf;
+        int16 beta = inf;
+        if (id >= 2) {
+          alpha = std::max(static_cast<int16>(center - delta), static_cast<int16>(ninf));
+          beta = std::min(static_cast<int16>(center + delta), static_cast<int16>(inf));
+        }
 
-    while (true) {
-      if (id >= 2) {
-        alpha = std::max(static_cast<int16>(eval - delta), static_cast<int16>(ninf));
-        beta = std::min(static_cast<int16>(eval + delta), static_cast<int16>(inf));
-      }
+        {
+          trace::scope window("aspiration window", "alpha", alpha, "beta", beta);
+          eval = search<root>(p, alpha, beta, id, root_node);
+        }
 
-      eval = search<root>(p, alpha, beta, id, stack + 2);
+        rml.sort(k);
 
-      if (p.is_master() && !UCI_SIGNALS.stop) {
-        if (silent) get_bestmove(p);
-        else readout_pv(p, eval, id);
+        if (p.sigs().stop) break;
 
-        if (id >= thread_depth && !slaves_start) {
-          slaves_start = true;
-          cv.notify_all();
-        }
+        root_move& line = rml[k];
 
-        if (id == depth) UCI_SIGNALS.stop = true;
-      }
+        const bool inside = eval > alpha && eval < beta;
 
-      if (UCI_SIGNALS.stop) break;
+        if (p.is_master() && k == 0) {
+          ctx.bestscore = eval;
+          for (unsigned j = 0; j < 2; ++j) ctx.bestmoves[j] = (j < line.pv.size() ? line.pv[j] : Move{});
+          ctx.pv = line.pv;
+          if (!silent && lines == 1) print_pv(line, 0, lines, id, inside ? "" : eval >= beta ? "lowerbound" : "upperbound");
 
-      if (eval <= alpha) {
-        delta += delta;
-      }
-      else if (eval >= beta) {
+          if (inside) {
+            exact = true;
+            best_fraction = rml.best_fraction();
+          }
+          else if (p.sigs().timer.soft_expired()) {
+            trace::instant("soft deadline", "depth", id);
+            p.sigs().stop = true;
+          }
+        }
+
+        if (p.sigs().stop || inside) break;
+        trace::instant(eval <= alpha ? "fail low" : "fail high", "depth", id, "score", eval);
+
+        if (eval <= alpha && k == 0) ++fail_lows;
+        center = eval;
         delta += delta;
       }
-      else break;
+    }
+
+    if (!p.is_master() || p.sigs().stop) continue;
+    STAT(p.search_counters().depth_nodes[id < search_stats::max_depth ? id : search_stats::max_depth] =
+      p.search_counters().nodes + p.search_counters().qnodes);
+    ctx.depth = static_cast<U16>(id);
+
+    rml.sort(0);
+    if (lines > 1) {
+      ctx.bestscore = rml[0].score;
+      for (unsigned j = 0; j < 2; ++j) ctx.bestmoves[j] = (j < rml[0].pv.size() ? rml[0].pv[j] : Move{});
+      ctx.pv = rml[0].pv;
+      if (!silent) for (unsigned k = 0; k < lines; ++k) print_pv(rml[k], k, lines, id);
+    }
+
+    // a finished iteration lets the clock adapt and decide whether another one fits
+    // go mate n: done once a mate in n or shorter is proven
+    const bool mate_found = ctx.mate_plies > 0 && exact && ctx.bestscore >= mate - ctx.mate_plies;
+    if (id == depth || mate_found ||
+      (exact && p.sigs().timer.update(ctx.bestmoves[0], ctx.bestscore, fail_lows, best_fraction)) ||
+      p.sigs().timer.soft_expired()) {
+      if (p.sigs().pondering) break; // start() holds the result until ponderhit/stop
+      trace::instant("iterations done", "depth", id);
+      p.sigs().stop = true;
     }
   }
 
@@ -300,7 +404,14 @@ inline void Search::iterative_deepening(position& p, U16 depth, bool silent) {
 template<Nodetype type>
 Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * stack) {
 
-  if (UCI_SIGNALS.stop) { return draw; }
+  if (p.is_master() && p.sigs().timer.poll(p.nodes())) {
+    if (!p.sigs().times_up) trace::instant("hard deadline");
+    p.sigs().stop = p.sigs().times_up = true;
+  }
+  stack->pv_length = 0;
+  if (p.sigs().budget.exhausted(p.id(), p.nodes())) { p.sigs().stop = true; }
+  if (p.sigs().stop) { return draw; }
+  STAT(++p.search_counters().nodes);
 
   assert(alpha < beta);
 
@@ -310,15 +421,22 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
 
   Move ttm = {}; ttm.type = no_type; // refactor me
   Score ttvalue = ninf;
+  U16 tt_depth = 0;
+  U8 tt_bound = bound_high;
+
+  // singular verification search: same position without the hash move
+  const bool excluding = stack->excluded_move.f != stack->excluded_move.t;
 
   bool in_check = p.in_check();
   stack->in_check = in_check;
   const bool pv_type = (type == root || type == pv);
 
   std::vector<Move> quiets;
+  std::vector<Move> captures;
 
   stack->ply = (stack - 1)->ply + 1;
   U16 root_dist = stack->ply;
+  log_tree(p, tree_node, stack, depth, alpha, beta, 0, (stack - 1)->curr_move);
 
   { // mate distance pruning
 	  auto mating_score = static_cast<Score>(mate - root_dist);
@@ -334,15 +452,22 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
 
   {  // hashtable lookup
     hash_data e{};
-    if (ttable.fetch(p.key(), e)) {
+    STAT(++p.search_counters().tt_probes);
+    if (p.tt().fetch(p.key(), e)) {
+      STAT(++p.search_counters().tt_hits);
       ttm = e.move;
       ttvalue = static_cast<Score>(e.score);
+      tt_depth = e.depth;
+      tt_bound = e.bound;
 
-      if (e.depth >= depth) {
+      if (type != root && !excluding && e.depth >= depth) {
         if ((ttvalue >= beta && e.bound == bound_low) ||
           (ttvalue <= alpha && e.bound == bound_high) ||
-          (ttvalue > alpha && ttvalue < beta && e.bound == bound_exact))
+          (ttvalue > alpha && ttvalue < beta && e.bound == bound_exact)) {
+          STAT(++p.search_counters().tt_cutoffs);
+          log_tree(p, tree_tt_cut, stack, depth, alpha, beta, ttvalue, ttm);
           return ttvalue;
+        }
       }
     }
   }
@@ -355,6 +480,8 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
 	                       ?
     ttvalue : !in_check ? static_cast<Score>(std::lround(eval::evaluate(p, lazy_eval_margin(depth, advanced_pawns)))) : ninf);
   stack->static_eval = static_eval;
+  if (ttvalue != ninf) STAT(++p.search_counters().eval_tt_hits);
+  else if (!in_check) STAT(++p.search_counters().eval_calls);
 
   if (p.debug_search && ttvalue == ninf && !in_check) {
     debug_file << p.to_fen() << " eval:" << static_eval << "\n";
@@ -365,6 +492,7 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
     !pv_type &&
     (stack - 1)->curr_move.type == quiet &&
     !stack->null_search &&
+    !excluding &&
     abs(alpha - beta) == 1 && // only prune in null windows (same condition as !pv_node)
     static_eval != ninf);
 
@@ -372,7 +500,11 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
   if (forward_prune && !stm_pawns_on_7th &&
     depth <= 1 &&
     static_eval > mated_max_ply &&
-    static_eval + 950 < alpha) return static_cast<Score>(alpha);
+    static_eval + 950 < alpha) {
+    STAT(++p.search_counters().futility_prunes);
+    log_tree(p, tree_futility, stack, depth, alpha, beta, static_eval, Move{});
+    return static_cast<Score>(alpha);
+  }
 
   // 0. razoring - prune when losing
   float rm = razor_margin(depth);
@@ -389,6 +521,8 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
       Score v = qsearch<non_pv>(p, alpha, beta, 0, stack);
       if (v <= alpha) {
         //prob_cut_successes++;
+        STAT(++p.search_counters().razor_prunes);
+        log_tree(p, tree_razor, stack, depth, alpha, beta, v, Move{});
         return v;
       }
     }
@@ -398,6 +532,8 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
       Score v = qsearch<non_pv>(p, ralpha, ralpha + 1, 0, stack);
       if (v <= ralpha) {
         //prob_cut_successes++;
+        STAT(++p.search_counters().razor_prunes);
+        log_tree(p, tree_razor, stack, depth, alpha, beta, v, Move{});
         return v;
       }
     }
@@ -416,6 +552,7 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
     int16 ndepth = depth - R;
 
     (stack + 1)->null_search = true;
+    STAT(++p.search_counters().null_tries);
 
     p.do_null_move();
 
@@ -425,7 +562,11 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
 
     (stack + 1)->null_search = false;
 
-    if (null_eval >= beta) return static_cast<Score>(beta); // null_eval;
+    if (null_eval >= beta) {
+      STAT(++p.search_counters().null_cutoffs);
+      log_tree(p, tree_null_cut, stack, depth, alpha, beta, null_eval, Move{});
+      return static_cast<Score>(beta); // null_eval;
+    }
 
     // threat move - null move failed low (counter array)
     // if from sq of our (quiet) move == to square of threat --> give move ordering bonus to quiet move
@@ -457,6 +598,7 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
 
   // 3. internal iterative deepening - improve move ordering
   if (ttm.type == no_type &&
+    !excluding &&
     depth >= (pv_type ? 6 : 4) &&
     (pv_type || static_eval + 50 >= beta)) {
 
@@ -472,7 +614,7 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
 
     {
       hash_data e{};
-      if (ttable.fetch(p.key(), e)) { ttm = e.move; }
+      if (p.tt().fetch(p.key(), e)) { ttm = e.move; }
     }
   }
 
@@ -559,16 +701,26 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
   Move pre_pre_move = (stack - 2)->curr_move;
   bool improving = stack->static_eval - (stack - 2)->static_eval >= 0;
 
-  while (mvs.next_move<main0>(p, move, pre_move, pre_pre_move, stack->threat_move)) {
+  // the root walks its own move list (from the current multipv line on)
+  root_move_list * rml = (type == root ? stack->root_moves : nullptr);
+  size_t root_idx = (rml ? rml->pv_index : 0);
+  auto next_move = [&](Move& m) {
+    if (!rml) return mvs.next_move<main0>(p, m, pre_move, pre_pre_move, stack->threat_move);
+    if (root_idx >= rml->size()) return false;
+    m = (*rml)[root_idx++].move;
+    return true;
+  };
 
-    if (UCI_SIGNALS.stop) { return draw; }
+  while (next_move(move)) {
+
+    if (p.sigs().stop) { return draw; }
 
     // thread update (todo)
 
     // edge case: if we deferred a move causing a beta cut - recheck the hashtable and return early
     //if (deferred > 0) {
     //  hash_data e;
-    //  if (ttable.fetch(p.key(), e)) {
+    //  if (p.tt().fetch(p.key(), e)) {
     //    if (e.score >= beta && e.depth >= depth && e.bound == bound_low) {
     //      return Score(e.score);
     //    }
@@ -580,6 +732,8 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
       continue;
     }
 
+    if (excluding && move == stack->excluded_move) continue;
+
 
     // see pruning
     if (move != ttm &&
@@ -594,7 +748,11 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
       move.type != p.is_promotion(move.type) &&
       depth <= 1 &&
       moves_searched > 1 &&
-      p.see(move) < 0) continue;
+      !p.see_ge(move, 0)) {
+      STAT(++p.search_counters().see_prunes);
+      log_tree(p, tree_see_prune, stack, depth, alpha, beta, best_score, move);
+      continue;
+    }
 
 
     // continue if another thread is already searching this position
@@ -603,14 +761,46 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
       stack->deferred_moves[deferred++] = move;
       continue;
     }
-    set_searching(p, move);
+    // singular extension - the hash move holds a lower bound at close to full
+    // depth, verify with a reduced search of the other moves below that bound.
+    // nothing else comes close: extend it, several moves do: cut (multi-cut)
+    int16 singular = 0;
+    if (type != root &&
+      !excluding &&
+      depth >= 8 &&
+      move == ttm &&
+      tt_bound == bound_low &&
+      tt_depth + 3 >= depth &&
+      ttvalue > mated_max_ply && ttvalue < mate_max_ply) {
+
+      const auto sbeta = static_cast<int16>(ttvalue - 2 * depth);
+      stack->excluded_move = move;
+      Score v = search<non_pv>(p, sbeta - 1, sbeta, (depth - 1) / 2, stack);
+      stack->excluded_move = {};
+
+      if (v < sbeta) singular = 1;
+      else if (!pv_type && sbeta >= beta) {
+        log_tree(p, tree_multicut, stack, depth, alpha, beta, v, move);
+        return static_cast<Score>(sbeta);
+      }
+    }
+
+    if (depth > thread_depth) set_searching(p, move);
+
+    // history of a quiet move (butterfly + continuation), read while its piece
+    // is still on the from square
+    const int hscore = (move.type != quiet ? 0 : p.to_move() == white ?
+      p.history_stats().score<white>(p, move, pre_move, pre_pre_move, stack->threat_move) :
+      p.history_stats().score<black>(p, move, pre_move, pre_pre_move, stack->threat_move));
+    const bool is_capture = move.type == ep || (move.type != quiet && p.piece_on(static_cast<Square>(move.t)) != no_piece);
 
+    const U64 nodes_before = p.nodes();
     p.do_move(move);
 
     stack->curr_move = move;
 
     bool gives_check = p.in_check();
-    int16 extensions = gives_check;// +in_check;
+    int16 extensions = std::max(static_cast<int16>(gives_check), singular);// +in_check;
 
     int16 reductions = 1;
 
@@ -633,9 +823,6 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
 
       // reduce with history score
       //if (depth > 8) {
-      int hscore = (p.to_move() == white ?
-        p.history_stats().score<white>(move, (stack - 1)->curr_move, (stack - 2)->curr_move, stack->threat_move) :
-        p.history_stats().score<black>(move, (stack - 1)->curr_move, (stack - 2)->curr_move, stack->threat_move));
       if (hscore < 0)
       {
         reductions += 1;
@@ -667,13 +854,21 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
         //newdepth >= 2 &&
         best_score <= alpha) {
         unsigned R = reduction(pv_type, improving, depth, moves_searched);
+
+        // reduce well-ordered quiets less, poorly-ordered ones more
+        if (hscore >= move_history::history_max / 2 && R > 0) --R;
+        else if (hscore <= -move_history::history_max / 2) ++R;
+
         LMR -= R;
       }
+      const bool reduced = LMR < newdepth;
+      if (reduced) STAT(++p.search_counters().lmr_searches);
 
       score = static_cast<Score>(LMR <= 1 ? -qsearch<non_pv>(p, -alpha - 1, -alpha, 0, stack + 1) : -search<non_pv>(p, -alpha - 1, -alpha, LMR - 1, stack + 1));
 
 
       if (score > alpha) {
+        if (reduced) STAT(++p.search_counters().lmr_researches);
 
         score = static_cast<Score>(newdepth <= 1 ? -qsearch<pv>(p, -beta, -alpha, 0, stack + 1) : -search<pv>(p, -beta, -alpha, newdepth - 1, stack + 1));
       }
@@ -683,28 +878,42 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
     ++moves_searched;
 
     if (move.type == quiet) quiets.emplace_back(move);
+    else if (is_capture) captures.emplace_back(move);
 
     p.undo_move(move);
 
     // note: uncomment only if smp search
-    unset_searching(p, move);
+    if (depth > thread_depth) unset_searching(p, move);
+
 
+    if (type == root) {
+      root_move * rm = rml->find(move);
+      rm->nodes += p.nodes() - nodes_before;
+      rm->score = (moves_searched == 1 || score > alpha ? score : ninf);
+      if (moves_searched == 1 || score > alpha) {
+        rm->pv.assign(1, move);
+        rm->pv.insert(rm->pv.end(), (stack + 1)->pv, (stack + 1)->pv + (stack + 1)->pv_length);
+      }
+    }
 
     if (score > best_score) {
       best_score = score;
       best_move = move;
 
       if (score > alpha) {
+        if (pv_type) update_pv(stack, move);
         alpha = score;
       }
 
       if (score >= beta) {
+        STAT(++p.search_counters().fail_highs);
+        if (moves_searched == 1) STAT(++p.search_counters().fail_highs_first);
 
         deferred = 0; // skip deferred moves
-        if (best_move.type == quiet) {
+        if (best_move.type == quiet || is_capture) {
           p.stats_update(best_move,
-            (stack - 1)->curr_move,
-            depth, score, quiets, stack->killers);
+            pre_move, pre_pre_move,
+            depth, score, quiets, captures, stack->killers);
         }
 
         break;
@@ -758,6 +967,10 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
     //  p.see(dmove) < 0) continue;
 
 
+    const int dscore = (dmove.type != quiet ? 0 : p.to_move() == white ?
+      p.history_stats().score<white>(p, dmove, pre_move, pre_pre_move, stack->threat_move) :
+      p.history_stats().score<black>(p, dmove, pre_move, pre_pre_move, stack->threat_move));
+
     p.do_move(dmove);
 
     bool gives_check = p.in_check();
@@ -782,10 +995,7 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
 
       // reduce with history score
       if (depth > 8) {
-        int hscore = (p.to_move() == white ?
-          p.history_stats().score<white>(dmove, (stack - 1)->curr_move, (stack - 2)->curr_move, stack->threat_move) :
-          p.history_stats().score<black>(dmove, (stack - 1)->curr_move, (stack - 2)->curr_move, stack->threat_move));
-        if (hscore < 0)
+        if (dscore < 0)
         {
           reductions += 1;
         }
@@ -839,14 +1049,15 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
       best_move = dmove;
 
       if (score >= alpha) {
+        if (pv_type && score > alpha) update_pv(stack, dmove);
         alpha = score;
       }
 
       if (score >= beta) {
 
         if (best_move.type == quiet) {
-          p.stats_update(best_move, (stack - 1)->curr_move,
-            depth, score, quiets, stack->killers);
+          p.stats_update(best_move, pre_move, pre_pre_move,
+            depth, score, quiets, captures, stack->killers);
         }
 
         break;
@@ -873,13 +1084,19 @@ Score Search::search(position& p, int16 alpha, int16 beta, U16 depth, node * sta
 
 
   if (moves_searched == 0) {
+    if (excluding) return static_cast<Score>(alpha); // the hash move was the only one
     return (in_check ? static_cast<Score>(mated + root_dist) : draw);
   }
 
 
+  // a root search without the higher multipv moves (or a singular verification
+  // search without the hash move) is not a result for this position
+  if ((type == root && rml->pv_index > 0) || excluding) return best_score;
+
   Bound bound = (best_score >= beta ? bound_low :
     best_score <= alpha ? bound_high : bound_exact);
-  ttable.save(p.key(), depth, static_cast<U8>(bound), static_cast<U8>(stack->ply), best_move, best_score, pv_type);
+  p.tt().save(p.key(), depth, static_cast<U8>(bound), p.tt().age(), best_move, best_score, pv_type);
+  log_tree(p, tree_result, stack, depth, alpha, beta, best_score, best_move);
 
   return best_score;
 }
@@ -889,7 +1106,13 @@ const std::vector<float> material_vals{ 100.0f, 300.0f, 315.0f, 480.0f, 910.0f }
 template<Nodetype type>
 Score Search::qsearch(position& p, int16 alpha, int16 beta, U16 depth, node * stack) {
 
-  if (UCI_SIGNALS.stop) { return draw; }
+  if (p.is_master() && p.sigs().timer.poll(p.nodes())) {
+    if (!p.sigs().times_up) trace::instant("hard deadline");
+    p.sigs().stop = p.sigs().times_up = true;
+  }
+  stack->pv_length = 0;
+  if (p.sigs().budget.exhausted(p.id(), p.nodes())) { p.sigs().stop = true; }
+  if (p.sigs().stop) { return draw; }
 
 
   Score best_score = ninf;
@@ -899,27 +1122,38 @@ Score Search::qsearch(position& p, int16 alpha, int16 beta, U16 depth, node * st
   Move ttm = {};
   ttm.type = no_type;
   bool pv_type = type == pv;
+  const int16 alpha0 = alpha;
+  STAT(++p.search_counters().qnodes);
 
   stack->ply = (stack - 1)->ply + 1;
   U16 root_dist = stack->ply;
+  log_tree(p, tree_qnode, stack, depth, alpha, beta, 0, (stack - 1)->curr_move);
 
   bool in_check = p.in_check();
   stack->in_check = in_check;
 
+  // depth counts qsearch plies below the horizon, quiet checks only on the first
+  stack->gen_checks = (depth == 0);
+
 
   if (p.is_draw()) return draw;
 
   {  // hashtable lookup
     hash_data e{};
-    if (ttable.fetch(p.key(), e)) {
+    STAT(++p.search_counters().tt_probes);
+    if (p.tt().fetch(p.key(), e)) {
+      STAT(++p.search_counters().tt_hits);
       ttm = e.move;
       auto ttvalue = static_cast<Score>(e.score);
 
-      if (e.depth >= depth) {
+      { // any entry is at least a qsearch result (qsearch stores depth 0)
         if ((ttvalue >= beta && e.bound == bound_low) ||
           (ttvalue <= alpha && e.bound == bound_high) ||
-          (ttvalue > alpha && ttvalue < beta && e.bound == bound_exact))
+          (ttvalue > alpha && ttvalue < beta && e.bound == bound_exact)) {
+          STAT(++p.search_counters().tt_cutoffs);
+          log_tree(p, tree_qtt_cut, stack, depth, alpha, beta, ttvalue, ttm);
           return ttvalue;
+        }
       }
     }
   }
@@ -929,13 +1163,21 @@ Score Search::qsearch(position& p, int16 alpha, int16 beta, U16 depth, node * st
   if (!in_check) {
 
     best_score = static_cast<Score>(std::lround(eval::evaluate(p, lazy_eval_margin(1, true))));
+    STAT(++p.search_counters().eval_calls);
 
     if (p.debug_search) {
       debug_file << p.to_fen() << " eval:" << best_score << "\n";
     }
 
-    if (best_score + 975 < alpha) return best_score;
-    if (best_score >= beta) return best_score;
+    if (best_score + 975 < alpha) {
+      log_tree(p, tree_delta_prune, stack, depth, alpha, beta, best_score, Move{});
+      return best_score;
+    }
+    if (best_score >= beta) {
+      log_tree(p, tree_stand_pat, stack, depth, alpha, beta, best_score, Move{});
+      p.tt().save(p.key(), 0, static_cast<U8>(bound_low), p.tt().age(), best_move, best_score, pv_type);
+      return best_score;
+    }
     if (alpha < best_score) alpha = best_score;
   }
 
@@ -1001,10 +1243,8 @@ Score Search::qsearch(position& p, int16 alpha, int16 beta, U16 depth, node * st
   */
 
 
-  U16 qsdepth = in_check ? 1 : 0;
-
   U16 moves_searched = 0;
-  move_order mvs(p, ttm, stack->killers);
+  move_order mvs(p, ttm, stack->killers, stack->gen_checks);
   Move move{};
   Move pre_move = (stack - 1)->curr_move;
   Move pre_pre_move = (stack - 2)->curr_move;
@@ -1012,7 +1252,7 @@ Score Search::qsearch(position& p, int16 alpha, int16 beta, U16 depth, node * st
   while (mvs.next_move<search_type::qsearch>(p, move, pre_move, pre_pre_move, stack->threat_move)) {
 
 
-    if (UCI_SIGNALS.stop) { return draw; }
+    if (p.sigs().stop) { return draw; }
 
 
     if (move.type == no_type || !p.is_legal(move)) {
@@ -1036,24 +1276,18 @@ Score Search::qsearch(position& p, int16 alpha, int16 beta, U16 depth, node * st
     }
 
 
-    // see pruning
-    if (
-      //move != ttm &&
-      //move != stack->killers[0] &&
-      //move != stack->killers[1] &&
-      //move != stack->killers[2] &&
-      //move != stack->killers[3] &&
-      //!pv_type &&
-      !in_check &&
-      best_score < alpha &&
-      //moves_searched > 1 &&
-      p.see(move) < 0) continue;
+    // see pruning - losing captures and checks to unsafe squares
+    if (!in_check && !p.see_ge(move, 0)) {
+      STAT(++p.search_counters().see_prunes);
+      log_tree(p, tree_qsee_prune, stack, depth, alpha, beta, best_score, move);
+      continue;
+    }
 
 
     p.do_move(move);
     p.adjust_qnodes(1);
 
-    auto score = static_cast<Score>(-qsearch<type>(p, -beta, -alpha, 0, stack + 1));
+    auto score = static_cast<Score>(-qsearch<type>(p, -beta, -alpha, depth + 1, stack + 1));
 
     ++moves_searched;
 
@@ -1064,6 +1298,7 @@ Score Search::qsearch(position& p, int16 alpha, int16 beta, U16 depth, node * st
       best_score = score;
       best_move = move;
 
+      if (pv_type && score > alpha) update_pv(stack, move);
       if (score >= alpha) alpha = score;
       if (score >= beta) { break; }
     }
@@ -1076,53 +1311,36 @@ Score Search::qsearch(position& p, int16 alpha, int16 beta, U16 depth, node * st
   }
 
 
-  //Bound bound = (best_score >= beta ? bound_low :
-  //  best_score <= alpha ? bound_high : bound_exact);
-  //ttable.save(p.key(), qsdepth, U8(bound), stack->ply, best_move, best_score, pv_type);
-  //
+  Bound bound = (best_score >= beta ? bound_low :
+    pv_type && best_score > alpha0 ? bound_exact : bound_high);
+  p.tt().save(p.key(), 0, static_cast<U8>(bound), p.tt().age(), best_move, best_score, pv_type);
 
   return best_score;
 }
 
 
-inline void Search::get_bestmove(position& p) {
+// legal root moves, the hash move first
+inline Search::root_move_list::root_move_list(position& p) {
   hash_data e{};
-  ttable.fetch(p.key(), e);
-
-  if (e.move.type != no_type &&
-    e.move.f != e.move.t &&
-    p.is_legal(e.move))
-    bestmoves[0] = e.move;
+  Move ttm{};
+  ttm.type = no_type;
+  if (p.tt().fetch(p.key(), e)) ttm = e.move;
+
+  Movegen mvs(p);
+  mvs.generate<pseudo_legal, pieces>();
+  for (int j = 0; j < mvs.size(); ++j) {
+    if (!p.is_legal(mvs[j])) continue;
+    moves.push_back(root_move{ mvs[j], ninf, ninf, 0, {} });
+    if (mvs[j] == ttm) std::swap(moves.front(), moves.back());
+  }
 }
 
-inline void Search::readout_pv(position& p, const Score& eval, const U16& depth) {
-
-  hash_data e{};
+inline void Search::print_pv(const root_move& line, const unsigned& index, const unsigned& lines, const U16& depth, const char * bound) {
   std::string res;
-  std::vector<Move> moves;
-
-  for (unsigned j = 0;
-    ttable.fetch(p.key(), e) &&
-    e.move.type != no_type &&
-    e.move.f != e.move.t &&
-    p.is_legal(e.move) &&
-    j < depth; ++j) {
-
-    res += uci::move_to_string(e.move) + " ";
-    p.do_move(e.move);
-    moves.push_back(e.move);
-
-    if (j <= 1) bestmoves[j] = e.move;
-  }
-
-  while (!moves.empty()) {
-    Move m = moves.back();
-    p.undo_move(m);
-    moves.pop_back();
-  }
+  for (const auto& m : line.pv) res += uci::move_to_string(m) + " ";
 
-  printf("info score cp %d depth %d pv ",
-    eval,
-    depth);
+  const std::string score = std::to_string(line.score) + (*bound ? std::string(" ") + bound : "");
+  if (lines > 1) printf("info multipv %u score cp %s depth %d pv ", index + 1, score.c_str(), depth);
+  else printf("info score cp %s depth %d pv ", score.c_str(), depth);
   std::cout << res << std::endl;
 }
@@ -0,0 +1,201 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of the Havoc chess engine
+Copyright (c) 2020 Minniesoft
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#pragma once
+
+#ifndef SELFPLAY_H
+#define SELFPLAY_H
+
+#include <string>
+#include <vector>
+#include <random>
+#include <cstring>
+#include <iostream>
+
+#include "position.h"
+#include "types.h"
+#include "move.h"
+#include "search.h"
+#include "evaluate.h"
+#include "packed.h"
+#include "hashtable.h"
+#include "pawns.h"
+#include "material.h"
+#include "uci.h"
+
+namespace selfplay {
+
+  // legal moves of the side to move
+  inline std::vector<Move> legal_moves(position& p) {
+    std::vector<Move> legal;
+    Movegen mvs(p);
+    mvs.generate<pseudo_legal, pieces>();
+    for (int i = 0; i < mvs.size(); ++i) {
+      if (p.is_legal(mvs[i])) legal.push_back(mvs[i]);
+    }
+    return legal;
+  }
+
+  inline bool find_move(position& p, const std::string& s, Move& m) {
+    for (auto& mv : legal_moves(p)) {
+      if (uci::move_to_string(mv) == s) { m = mv; return true; }
+    }
+    return false;
+  }
+
+  // hash tables and stop signal owned by one game, so games can run concurrently
+  struct game_tables {
+    hash_table tt;
+    pawn_table pt;
+    material_table mt;
+    signals sig{};
+
+    explicit game_tables(const size_t& hash_mb = 16) : tt(hash_mb), pt(1), mt(1) { }
+    game_tables(const game_tables& o) = delete;
+    game_tables(const game_tables&& o) = delete;
+    game_tables& operator=(const game_tables& o) = delete;
+    game_tables& operator=(const game_tables&& o) = delete;
+
+    void bind(position& p) {
+      p.set_hash_table(&tt);
+      p.set_eval_tables(&pt, &mt);
+      p.set_signals(&sig);
+    }
+
+    void clear() const { tt.clear(); pt.clear(); mt.clear(); }
+  };
+
+  // fen after random legal plies from the start position (retries dead ends)
+  inline std::string random_opening(std::mt19937& rng, const unsigned& plies) {
+    while (true) {
+      position p;
+      std::istringstream fen(START_FEN);
+      p.setup(fen);
+
+      unsigned ply = 0;
+      for (; ply < plies; ++ply) {
+        std::vector<Move> legal = legal_moves(p);
+        if (legal.empty()) break;
+        p.do_move(legal[rng() % legal.size()]);
+      }
+      if (ply == plies && !legal_moves(p).empty()) return p.to_fen();
+    }
+  }
+
+  inline std::string result_string(const Result& r) {
+    return r == pgn_wwin ? "1-0" : r == pgn_bwin ? "0-1" : "1/2-1/2";
+  }
+
+  // plays one game from fen, each side searching with its own parameters and
+  // its own tables: pawn entries cache parameter dependent scores and hash
+  // entries one side's search results, neither may leak to the other side.
+  // games are drawn at 400 plies or on repetition/50 moves and adjudicated
+  // once the mover's score stays beyond 1500 for 6 plies.  quiet positions
+  // with the mover's score are appended to records when given
+  inline Result play_game(const std::string& start_fen,
+                          const parameters& white_params,
+                          const parameters& black_params,
+                          limits lims,
+                          game_tables& white_tables,
+                          game_tables& black_tables,
+                          std::vector<packed_position> * records = nullptr) {
+    position p;
+    std::istringstream fen(start_fen);
+    p.setup(fen);
+    white_tables.clear();
+    if (&black_tables != &white_tables) black_tables.clear();
+
+    unsigned decisive = 0;
+
+    for (unsigned ply = 0; ; ++ply) {
+      std::vector<Move> legal = legal_moves(p);
+
+      if (legal.empty()) {
+        return (!p.in_check() ? pgn_draw : p.to_move() == white ? pgn_bwin : pgn_wwin);
+      }
+      if (p.is_draw() || ply >= 400) return pgn_draw;
+
+      p.params = (p.to_move() == white ? white_params : black_params);
+      (p.to_move() == white ? white_tables : black_tables).bind(p);
+      p.sigs().reset(lims.ponder);
+      Search::start(p, lims, true);
+
+      Move m{};
+      if (!find_move(p, p.bestmove, m)) m = legal[0];
+
+      if (records && !p.in_check()) {
+        packed_position pp{};
+        p.pack(pp);
+        pp.score = static_cast<int16>(p.bestscore);
+        records->push_back(pp);
+      }
+
+      decisive = (std::abs(p.bestscore) >= 1500 ? decisive + 1 : 0);
+      if (decisive >= 6) {
+        bool stm_wins = p.bestscore > 0;
+        return ((p.to_move() == white) == stm_wins ? pgn_wwin : pgn_bwin);
+      }
+
+      p.do_move(m);
+    }
+  }
+
+  // both sides with one set of tables, for games between equal parameters
+  inline Result play_game(const std::string& start_fen,
+                          const parameters& white_params,
+                          const parameters& black_params,
+                          limits lims,
+                          game_tables& tables,
+                          std::vector<packed_position> * records = nullptr) {
+    return play_game(start_fen, white_params, black_params, lims, tables, tables, records);
+  }
+
+  // plays fixed depth engine-vs-engine games from randomized openings and
+  // writes every quiet position with its search score and the game result
+  inline size_t generate(const unsigned& games, const unsigned& depth, const std::string& out, const unsigned& random_plies = 8) {
+    packed_writer writer(out, true);
+    std::mt19937 rng(std::random_device{}());
+    game_tables tables;
+
+    limits lims{};
+    memset(&lims, 0, sizeof(limits));
+    lims.depth = depth;
+
+    for (unsigned g = 0; g < games; ++g) {
+      std::vector<packed_position> records;
+      Result result = play_game(random_opening(rng, random_plies), eval::Parameters, eval::Parameters, lims, tables, &records);
+
+      for (auto& pp : records) {
+        pp.result = static_cast<U8>(result);
+        writer.write(pp);
+      }
+
+      std::cout << "game " << (g + 1) << "/" << games
+        << " result " << result_string(result)
+        << " positions " << writer.size() << "\r" << std::flush;
+    }
+    writer.close();
+    std::cout << std::endl;
+    return writer.size();
+  }
+}
+
+#endif
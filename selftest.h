@@ -0,0 +1,116 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of the Havoc chess engine
+Copyright (c) 2020 Minniesoft
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#ifndef SELFTEST_H
+#define SELFTEST_H
+
+#include <string>
+#include <sstream>
+#include <cstring>
+#include <vector>
+#include <iostream>
+
+#include "types.h"
+#include "hashtable.h"
+#include "position.h"
+#include "search.h"
+#include "selfplay.h"
+
+// quick correctness checks of pieces that are easy to get silently wrong:
+// each check prints ok or FAILED with what it saw, 'selftest' ends with the
+// pass count
+namespace selftest {
+
+  struct results {
+    unsigned passed = 0;
+    unsigned failed = 0;
+
+    void check(const std::string& name, const bool& ok, const std::string& detail = "") {
+      if (ok) ++passed; else ++failed;
+      std::cout << (ok ? "  ok      " : "  FAILED  ") << name;
+      if (!ok && !detail.empty()) std::cout << " (" << detail << ")";
+      std::cout << std::endl;
+    }
+  };
+
+  // hash entries read back what was saved: negative scores, depth 0 (qsearch)
+  // and the deepest depths
+  inline void hash_round_trip(results& r) {
+    hash_table tt(1);
+    tt.new_search();
+    const int16 scores[] = { -300, 300, 0, -1, static_cast<int16>(mate - 1), static_cast<int16>(mated + 1) };
+    const U8 depths[] = { 0, 1, 63, 64, 120 };
+    Move m{};
+    m.set(E2, E4, quiet);
+
+    U64 key = 0x9E3779B97F4A7C15ULL;
+    for (const int16 score : scores) {
+      for (const U8 depth : depths) {
+	key = key * 6364136223846793005ULL + 1442695040888963407ULL;
+	tt.clear();
+	tt.save(key, depth, bound_high, tt.age(), m, score, false);
+	hash_data e;
+	const bool found = tt.fetch(key, e);
+	const bool ok = found && e.score == score && e.depth == depth && e.bound == bound_high && e.move == m;
+	r.check("hash round trip score " + std::to_string(score) + " depth " + std::to_string(depth), ok,
+		found ? "read score " + std::to_string(e.score) + " depth " + std::to_string(static_cast<int>(e.depth)) : "not found");
+      }
+    }
+  }
+
+  // go mate 1 stops once the mate is proven, at depth 1 or 2
+  inline void mate_stop(results& r) {
+    const char * fens[] = {
+      "6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1",
+      "r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5Q2/PPPP1PPP/RNB1K1NR w KQkq - 0 1"
+    };
+    for (const char * fen : fens) {
+      selfplay::game_tables tables(1);
+      position p;
+      std::istringstream fs(fen);
+      p.setup(fs);
+      tables.bind(p);
+
+      limits lims;
+      memset(&lims, 0, sizeof(limits));
+      lims.mate = 1;
+      lims.depth = 8; // a search that misses the stop ends here and fails
+      p.sigs().reset(lims.ponder);
+      Search::start(p, lims, true);
+
+      const bool ok = p.bestscore == mate - 2 && p.bestdepth >= 1 && p.bestdepth <= 2;
+      r.check(std::string("go mate 1 stops: ") + fen, ok,
+	      "score " + std::to_string(p.bestscore) + " depth " + std::to_string(p.bestdepth));
+    }
+  }
+
+  inline void run() {
+    results r;
+    hash_round_trip(r);
+    mate_stop(r);
+    std::cout << "selftest: " << r.passed << " of " << (r.passed + r.failed) << " passed" << std::endl;
+  }
+}
+
+#endif
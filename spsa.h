@@ -0,0 +1,165 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of the Havoc chess engine
+Copyright (c) 2020 Minniesoft
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#pragma once
+
+#ifndef SPSA_H
+#define SPSA_H
+
+#include <string>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+#include "selfplay.h"
+#include "threads.h"
+#include "options.h"
+#include "parameter.h"
+#include "utils.h"
+
+// simultaneous perturbation stochastic approximation over the tuneable
+// parameters.  every iteration plays a batch of game pairs (same opening,
+// colors swapped) between theta + c*delta and theta - c*delta, each pair with
+// its own random delta, and steps theta along the averaged result.  games run
+// concurrently, one slot per worker thread, each slot owning a table set per
+// side
+namespace spsa {
+
+  struct settings {
+    unsigned iterations = 100;
+    unsigned pairs = 16;        // game pairs per iteration
+    unsigned depth = 4;
+    unsigned threads = 1;
+    unsigned random_plies = 8;
+    double a = 0.002;           // step size (in units of each parameter's magnitude)
+    double c = 0.05;            // perturbation size (same units)
+    double alpha = 0.602;
+    double gamma = 0.101;
+  };
+
+  // game pair score of the + side in [-1, 1]
+  inline double pair_score(const Result& plus_white, const Result& plus_black) {
+    auto pts = [](const Result& r, const Color& c) {
+      return r == pgn_draw ? 0.5 : (r == pgn_wwin) == (c == white) ? 1.0 : 0.0;
+    };
+    return pts(plus_white, white) + pts(plus_black, black) - 1.0;
+  }
+
+  inline void tune(parameters& theta, const settings& s) {
+    const size_t n = theta.tuneables().size();
+    const unsigned slots = std::max(1u, s.threads);
+    const double A = 0.1 * s.iterations;
+
+    std::vector<double> scale(n);
+    {
+      auto t = theta.tuneables();
+      for (size_t i = 0; i < n; ++i) scale[i] = std::max(1.0, std::fabs(static_cast<double>(*t[i].second)));
+    }
+
+    // per slot one table set for the + side and one for the - side, see play_game
+    std::vector<std::unique_ptr<selfplay::game_tables>> plus_tables, minus_tables;
+    for (unsigned i = 0; i < slots; ++i) {
+      plus_tables.emplace_back(util::make_unique<selfplay::game_tables>(8));
+      minus_tables.emplace_back(util::make_unique<selfplay::game_tables>(8));
+    }
+
+    Threadpool pool(slots);
+    std::mt19937 rng(std::random_device{}());
+
+    limits lims{};
+    memset(&lims, 0, sizeof(limits));
+    lims.depth = s.depth;
+
+    size_t games = 0;
+    util::clock timer;
+    timer.start();
+
+    for (unsigned k = 1; k <= s.iterations; ++k) {
+      const double ak = s.a / std::pow(k + A, s.alpha);
+      const double ck = s.c / std::pow(k, s.gamma);
+
+      // draw everything random up front so a batch is reproducible from the rng
+      std::vector<std::vector<int>> deltas(s.pairs, std::vector<int>(n));
+      std::vector<parameters> plus(s.pairs, theta), minus(s.pairs, theta);
+      std::vector<std::string> openings(s.pairs);
+
+      for (unsigned j = 0; j < s.pairs; ++j) {
+        auto tp = plus[j].tuneables();
+        auto tm = minus[j].tuneables();
+        for (size_t i = 0; i < n; ++i) {
+          deltas[j][i] = (rng() & 1) ? 1 : -1;
+          *tp[i].second += static_cast<float>(ck * scale[i] * deltas[j][i]);
+          *tm[i].second -= static_cast<float>(ck * scale[i] * deltas[j][i]);
+        }
+        openings[j] = selfplay::random_opening(rng, s.random_plies);
+      }
+
+      std::vector<double> results(s.pairs, 0.0);
+      for (unsigned slot = 0; slot < slots; ++slot) {
+        pool.enqueue([&, slot]() {
+          for (unsigned j = slot; j < s.pairs; j += slots) {
+            Result r1 = selfplay::play_game(openings[j], plus[j], minus[j], lims, *plus_tables[slot], *minus_tables[slot]);
+            Result r2 = selfplay::play_game(openings[j], minus[j], plus[j], lims, *minus_tables[slot], *plus_tables[slot]);
+            results[j] = pair_score(r1, r2);
+          }
+        });
+      }
+      pool.wait_finished();
+      games += 2 * s.pairs;
+
+      // gradient ascent on the + side's score, reduced in pair order
+      double total = 0;
+      std::vector<double> g(n, 0.0);
+      for (unsigned j = 0; j < s.pairs; ++j) {
+        total += results[j];
+        for (size_t i = 0; i < n; ++i) g[i] += results[j] * deltas[j][i];
+      }
+
+      auto t = theta.tuneables();
+      for (size_t i = 0; i < n; ++i) {
+        *t[i].second += static_cast<float>(ak * scale[i] * g[i] / (s.pairs * ck));
+      }
+
+      timer.stop();
+      const double minutes = std::max(timer.ms() / 60000.0, 1e-9);
+      std::cout << "iteration " << k << " plus score " << total / s.pairs
+        << " games " << games << " (" << static_cast<int>(games / minutes) << " games/min)" << std::endl;
+    }
+  }
+
+  // tunes eval::Parameters and saves them through options::save_param_file
+  inline void run(const settings& s, std::string param_file) {
+    parameters theta = eval::Parameters;
+    tune(theta, s);
+
+    for (auto& t : theta.tuneables()) {
+      opts->set<float>(t.first, *t.second);
+      std::cout << t.first << " : " << *t.second << std::endl;
+    }
+    eval::Parameters = theta;
+    opts->save_param_file(param_file);
+    std::cout << "..saved tuned parameters to " << param_file << std::endl;
+  }
+}
+
+#endif
@@ -0,0 +1,116 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of the Havoc chess engine
+Copyright (c) 2020 Minniesoft
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#pragma once
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <string>
+#include <sstream>
+#include <iomanip>
+
+#include "types.h"
+
+// per-thread search counters.  compiled in with -DSEARCH_STATS (make STATS=true),
+// otherwise every STAT() site compiles to nothing and the stats command only
+// reports that they are off.  each search thread owns its counters, so the
+// increments are plain adds; start() sums them once the search is over
+#ifdef SEARCH_STATS
+#define STAT(x) do { x; } while (0)
+#else
+#define STAT(x) do { } while (0)
+#endif
+
+struct search_stats {
+  static const unsigned max_depth = 64;
+
+  U64 nodes, qnodes;                  // search / qsearch entries
+  U64 tt_probes, tt_hits, tt_cutoffs;
+  U64 fail_highs, fail_highs_first;   // beta cuts, and those on the first move
+  U64 null_tries, null_cutoffs;
+  U64 lmr_searches, lmr_researches;   // reduced searches, and those re-searched
+  U64 futility_prunes, razor_prunes, see_prunes;
+  U64 eval_calls, eval_tt_hits;       // static evals computed / taken from the tt
+  U64 depth_nodes[max_depth + 1];     // nodes when each iteration finished
+  double elapsed_ms;
+
+  search_stats() { clear(); }
+
+  void clear() {
+    nodes = qnodes = 0;
+    tt_probes = tt_hits = tt_cutoffs = 0;
+    fail_highs = fail_highs_first = 0;
+    null_tries = null_cutoffs = 0;
+    lmr_searches = lmr_researches = 0;
+    futility_prunes = razor_prunes = see_prunes = 0;
+    eval_calls = eval_tt_hits = 0;
+    for (auto& n : depth_nodes) n = 0;
+    elapsed_ms = 0;
+  }
+
+  search_stats& operator+=(const search_stats& o) {
+    nodes += o.nodes; qnodes += o.qnodes;
+    tt_probes += o.tt_probes; tt_hits += o.tt_hits; tt_cutoffs += o.tt_cutoffs;
+    fail_highs += o.fail_highs; fail_highs_first += o.fail_highs_first;
+    null_tries += o.null_tries; null_cutoffs += o.null_cutoffs;
+    lmr_searches += o.lmr_searches; lmr_researches += o.lmr_researches;
+    futility_prunes += o.futility_prunes; razor_prunes += o.razor_prunes; see_prunes += o.see_prunes;
+    eval_calls += o.eval_calls; eval_tt_hits += o.eval_tt_hits;
+    for (unsigned d = 0; d <= max_depth; ++d) depth_nodes[d] += o.depth_nodes[d];
+    return *this;
+  }
+
+  static double rate(const U64& n, const U64& of) { return of > 0 ? static_cast<double>(n) / of : 0; }
+
+  // one json object.  ebf[d-1] is nodes(d) / nodes(d-1) for every finished depth d >= 2
+  std::string to_json() const {
+    std::ostringstream o;
+    o << std::setprecision(4);
+    o << "{\"enabled\":true"
+      << ",\"time_ms\":" << elapsed_ms
+      << ",\"nodes\":" << nodes
+      << ",\"qnodes\":" << qnodes
+      << ",\"qsearch_share\":" << rate(qnodes, nodes + qnodes)
+      << ",\"nps\":" << static_cast<U64>(elapsed_ms > 0 ? 1000.0 * (nodes + qnodes) / elapsed_ms : 0)
+      << ",\"tt\":{\"probes\":" << tt_probes << ",\"hits\":" << tt_hits << ",\"cutoffs\":" << tt_cutoffs
+      << ",\"hit_rate\":" << rate(tt_hits, tt_probes) << ",\"cutoff_rate\":" << rate(tt_cutoffs, tt_probes) << "}"
+      << ",\"fail_high\":{\"count\":" << fail_highs << ",\"first\":" << fail_highs_first
+      << ",\"first_rate\":" << rate(fail_highs_first, fail_highs) << "}"
+      << ",\"null_move\":{\"tries\":" << null_tries << ",\"cutoffs\":" << null_cutoffs
+      << ",\"rate\":" << rate(null_cutoffs, null_tries) << "}"
+      << ",\"lmr\":{\"searches\":" << lmr_searches << ",\"researches\":" << lmr_researches
+      << ",\"rate\":" << rate(lmr_researches, lmr_searches) << "}"
+      << ",\"pruned\":{\"futility\":" << futility_prunes << ",\"razor\":" << razor_prunes << ",\"see\":" << see_prunes << "}"
+      << ",\"eval\":{\"calls\":" << eval_calls << ",\"tt_hits\":" << eval_tt_hits
+      << ",\"hit_rate\":" << rate(eval_tt_hits, eval_calls + eval_tt_hits) << "}"
+      << ",\"ebf\":[";
+    bool first = true;
+    for (unsigned d = 2; d <= max_depth && depth_nodes[d] > 0; ++d) {
+      o << (first ? "" : ",") << rate(depth_nodes[d], depth_nodes[d - 1]);
+      first = false;
+    }
+    o << "]}";
+    return o.str();
+  }
+};
+
+#endif
@@ -0,0 +1,260 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of the Havoc chess engine
+Copyright (c) 2020 Minniesoft
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+#include "texel.h"
+#include "evaluate.h"
+#include "move.h"
+#include "options.h"
+#include "utils.h"
+
+
+namespace {
+
+  // target of a packed game result from white's point of view
+  inline double result_target(const packed_position& pp) {
+    return pp.result == pgn_wwin ? 1.0 : pp.result == pgn_bwin ? 0.0 : 0.5;
+  }
+
+  inline double sigmoid(const double& score, const double& k) {
+    return 1.0 / (1.0 + std::pow(10.0, -k * score / 400.0));
+  }
+
+  inline double cross_entropy(const double& s, const double& y) {
+    const double q = std::min(std::max(s, 1e-7), 1.0 - 1e-7);
+    return -(y * std::log(q) + (1.0 - y) * std::log(1.0 - q));
+  }
+
+  // static eval from white's point of view
+  inline float white_eval(const position& p) {
+    float s = eval::evaluate(p, -1);
+    return p.to_move() == white ? s : -s;
+  }
+
+  // no legal capture wins material for the side to move
+  inline bool is_quiet(position& p) {
+    if (p.in_check()) return false;
+    Movegen mvs(p);
+    mvs.generate<capture, pieces>();
+    for (int i = 0; i < mvs.size(); ++i) {
+      if (p.is_legal(mvs[i]) && p.see(mvs[i]) > 0) return false;
+    }
+    return true;
+  }
+}
+
+
+texel::texel(const unsigned& threads) : pool(std::max(threads, 1u)), K(1.0) {
+  for (unsigned i = 0; i < pool.size(); ++i) {
+    workers.emplace_back(util::make_unique<worker>());
+  }
+}
+
+
+// runs f(worker, begin, end, id) over equal contiguous slices of the data
+template<typename F>
+void texel::parallel(F&& f) {
+  const size_t n = workers.size();
+  for (size_t t = 0; t < n; ++t) {
+    const size_t begin = data.size() * t / n;
+    const size_t end = data.size() * (t + 1) / n;
+    worker * w = workers[t].get();
+    pool.enqueue([&f, w, begin, end, t]() { f(*w, begin, end, t); });
+  }
+  pool.wait_finished();
+}
+
+
+size_t texel::load(const std::string& filename, const size_t& max_positions) {
+  packed_file f(filename);
+  data.clear();
+
+  if (f.size() == 0) {
+    std::cout << "..no positions in " << filename << std::endl;
+    return 0;
+  }
+
+  // fixed seed so a capped load picks the same subset every run
+  f.shuffle(0x9E3779B97F4A7C15ULL);
+  const size_t n = (max_positions > 0 ? std::min(max_positions, f.size()) : f.size());
+  data.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    if (f.at(i).result != pgn_none) data.push_back(f.at(i));
+  }
+
+  std::vector<std::vector<packed_position>> quiet(workers.size());
+  parallel([this, &quiet](worker& w, const size_t& begin, const size_t& end, const size_t& id) {
+    for (size_t i = begin; i < end; ++i) {
+      w.p.setup(data[i]);
+      if (is_quiet(w.p)) quiet[id].push_back(data[i]);
+    }
+  });
+
+  data.clear();
+  for (auto& q : quiet) data.insert(data.end(), q.begin(), q.end());
+
+  std::cout << "..loaded " << data.size() << " quiet positions of " << n << " from " << filename << std::endl;
+  return data.size();
+}
+
+
+double texel::loss(const std::vector<float>& scores, const double& k) const {
+  double sum = 0;
+  for (size_t i = 0; i < scores.size(); ++i) {
+    sum += cross_entropy(sigmoid(scores[i], k), result_target(data[i]));
+  }
+  return scores.empty() ? 0 : sum / scores.size();
+}
+
+
+// golden section search of the sigmoid scale K that best fits the current eval
+double texel::fit_scaling(const parameters& params) {
+  std::vector<float> scores(data.size());
+
+  parallel([this, &params, &scores](worker& w, const size_t& begin, const size_t& end, const size_t& id) {
+    if (w.pawns.empty()) w.pawns.emplace_back(util::make_unique<pawn_table>(1));
+    w.pawns[0]->clear();
+    w.p.params = params;
+    w.p.set_eval_tables(w.pawns[0].get(), &w.material);
+    for (size_t i = begin; i < end; ++i) {
+      w.p.setup(data[i]);
+      scores[i] = white_eval(w.p);
+    }
+  });
+
+  const double gr = (std::sqrt(5.0) - 1.0) / 2.0;
+  double a = 0.05, b = 5.0;
+  double c = b - gr * (b - a), d = a + gr * (b - a);
+  double fc = loss(scores, c), fd = loss(scores, d);
+
+  while (b - a > 1e-4) {
+    if (fc < fd) { b = d; d = c; fd = fc; c = b - gr * (b - a); fc = loss(scores, c); }
+    else { a = c; c = d; fc = fd; d = a + gr * (b - a); fd = loss(scores, d); }
+  }
+
+  K = (a + b) / 2.0;
+  std::cout << "..fitted K " << K << " loss " << loss(scores, K) << std::endl;
+  return K;
+}
+
+
+// mean loss of every parameter set, one pass over the data.  the sums are
+// accumulated per worker slice and reduced in slice order so results do not
+// depend on scheduling
+std::vector<double> texel::losses(const std::vector<parameters>& sets) {
+
+  parallel([this, &sets](worker& w, const size_t& begin, const size_t& end, const size_t& id) {
+    while (w.pawns.size() < sets.size()) w.pawns.emplace_back(util::make_unique<pawn_table>(1));
+    for (size_t k = 0; k < sets.size(); ++k) w.pawns[k]->clear();
+    w.losses.assign(sets.size(), 0.0);
+
+    for (size_t i = begin; i < end; ++i) {
+      w.p.setup(data[i]);
+      const double y = result_target(data[i]);
+
+      for (size_t k = 0; k < sets.size(); ++k) {
+        w.p.params = sets[k];
+        w.p.set_eval_tables(w.pawns[k].get(), &w.material);
+        w.losses[k] += cross_entropy(sigmoid(white_eval(w.p), K), y);
+      }
+    }
+  });
+
+  std::vector<double> result(sets.size(), 0.0);
+  for (auto& w : workers) {
+    for (size_t k = 0; k < sets.size(); ++k) result[k] += w->losses[k];
+  }
+  for (auto& r : result) r /= std::max(data.size(), size_t(1));
+  return result;
+}
+
+
+// adam in units of each parameter's starting magnitude, so tempo (0.3) and
+// the attacker weights (up to 32) move at comparable relative rates
+double texel::tune(parameters& params, const unsigned& iterations, const double& rate) {
+  const double beta1 = 0.9, beta2 = 0.999, eps = 1e-8;
+
+  const size_t n = params.tuneables().size();
+  std::vector<double> scale(n), m(n, 0.0), v(n, 0.0);
+  {
+    auto t = params.tuneables();
+    for (size_t i = 0; i < n; ++i) scale[i] = std::max(1.0, std::fabs(static_cast<double>(*t[i].second)));
+  }
+
+  std::vector<parameters> sets(n + 1, params);
+  double current = 0;
+  util::clock timer;
+
+  for (unsigned it = 1; it <= iterations; ++it) {
+    timer.start();
+
+    // set 0 is the base point, set i + 1 nudges parameter i
+    std::vector<double> h(n);
+    for (size_t i = 0; i < n; ++i) {
+      sets[i + 1] = params;
+      float * x = sets[i + 1].tuneables()[i].second;
+      h[i] = 0.02 * scale[i];
+      *x += static_cast<float>(h[i]);
+      h[i] = *x - *params.tuneables()[i].second; // the step actually representable
+    }
+    sets[0] = params;
+
+    std::vector<double> L = losses(sets);
+    current = L[0];
+
+    auto t = params.tuneables();
+    for (size_t i = 0; i < n; ++i) {
+      const double g = (h[i] != 0 ? (L[i + 1] - L[0]) / h[i] : 0.0) * scale[i];
+      m[i] = beta1 * m[i] + (1 - beta1) * g;
+      v[i] = beta2 * v[i] + (1 - beta2) * g * g;
+      const double mh = m[i] / (1 - std::pow(beta1, it));
+      const double vh = v[i] / (1 - std::pow(beta2, it));
+      *t[i].second -= static_cast<float>(rate * scale[i] * mh / (std::sqrt(vh) + eps));
+    }
+
+    std::cout << "iteration " << it << " loss " << std::setprecision(8) << current
+      << " (" << std::setprecision(4) << timer.elapsed_ms() << " ms)" << std::setprecision(6) << std::endl;
+  }
+
+  return current;
+}
+
+
+void tuning::texel_tune(const std::string& packed_file, const unsigned& iterations, const unsigned& threads, std::string param_file) {
+  texel tuner(threads);
+  if (tuner.load(packed_file) == 0) return;
+
+  parameters params = eval::Parameters;
+  tuner.fit_scaling(params);
+  tuner.tune(params, iterations);
+
+  for (auto& t : params.tuneables()) {
+    opts->set<float>(t.first, *t.second);
+    std::cout << t.first << " : " << *t.second << std::endl;
+  }
+  eval::Parameters = params;
+  opts->save_param_file(param_file);
+  std::cout << "..saved tuned parameters to " << param_file << std::endl;
+}
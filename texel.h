@@ -0,0 +1,84 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of the Havoc chess engine
+Copyright (c) 2020 Minniesoft
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#pragma once
+
+#ifndef TEXEL_H
+#define TEXEL_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "types.h"
+#include "packed.h"
+#include "position.h"
+#include "pawns.h"
+#include "material.h"
+#include "parameter.h"
+#include "threads.h"
+
+// texel tuning of the float parameters over a packed file of quiet positions.
+// the loss is the sigmoid cross-entropy between the static eval and the game
+// result, minimized with adam on forward difference gradients.  every worker
+// owns a position and eval tables, and one sweep over the data evaluates the
+// base parameters and all perturbed copies so each record is unpacked once.
+class texel {
+
+  struct worker {
+    position p;
+    material_table material;
+    std::vector<std::unique_ptr<pawn_table>> pawns; // one per parameter set (pawn scores are param dependent)
+    std::vector<double> losses;
+
+    worker() : material(1) { }
+  };
+
+  std::vector<packed_position> data;
+  std::vector<std::unique_ptr<worker>> workers;
+  Threadpool pool;
+  double K;
+
+  template<typename F> void parallel(F&& f);
+  std::vector<double> losses(const std::vector<parameters>& sets);
+  double loss(const std::vector<float>& scores, const double& k) const;
+
+ public:
+  explicit texel(const unsigned& threads);
+  texel(const texel& o) = delete;
+  texel(const texel&& o) = delete;
+  texel& operator=(const texel& o) = delete;
+  texel& operator=(const texel&& o) = delete;
+  ~texel() = default;
+
+  size_t load(const std::string& filename, const size_t& max_positions = 0);
+  double fit_scaling(const parameters& params);
+  double tune(parameters& params, const unsigned& iterations, const double& rate = 0.01);
+  size_t size() const { return data.size(); }
+};
+
+
+namespace tuning {
+  // loads, tunes eval::Parameters and saves them through options::save_param_file
+  void texel_tune(const std::string& packed_file, const unsigned& iterations, const unsigned& threads, std::string param_file);
+}
+
+#endif
@@ -32,6 +32,8 @@ THE SOFTWARE.
 #include <atomic>
 #include <cassert>
 
+#include "trace.h"
+
 class Threadpool {
 	std::vector< std::thread > workers;
   std::deque< std::function<void() > > tasks;
@@ -46,7 +48,9 @@ class Threadpool {
   void thread_func() {
     while (true) {
       std::unique_lock<std::mutex> lock(m);
+      trace::record('B', "idle");
       cv_task.wait(lock, [this]() { return stop || !tasks.empty(); });
+      trace::record('E', "idle");
       if (!tasks.empty()) {
         ++busy;
         auto fn = tasks.front();
@@ -0,0 +1,209 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of the Havoc chess engine
+Copyright (c) 2020 Minniesoft
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#pragma once
+
+#ifndef TIMEMAN_H
+#define TIMEMAN_H
+
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <array>
+
+#include "types.h"
+
+// search clock on the monotonic clock.  the soft deadline ends iterative
+// deepening between iterations, the hard deadline aborts a running search and
+// is polled by the master thread every poll_nodes nodes.  negative = no limit.
+// limits and the start point are atomics so a ponderhit can re-arm the clock
+// while the search is running.
+// for clock-based budgets the soft deadline adapts after every iteration
+// (see update) around an optimum computed from the remaining time
+class time_manager {
+  typedef std::chrono::steady_clock clock;
+
+  std::atomic<long long> t0;
+  std::atomic<double> soft_ms;
+  std::atomic<double> hard_ms;
+  U64 next_poll;
+
+  std::atomic<bool> adaptive;
+  std::atomic<double> optimum_ms;
+
+  // iteration bookkeeping, master thread only
+  double instability;
+  double last_iteration_ms;
+  double prev_iteration_time;
+  unsigned iterations;
+  int last_eval;
+  Move last_best;
+
+  static long long now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(clock::now().time_since_epoch()).count();
+  }
+
+ public:
+  static const U64 poll_nodes = 1024;
+
+  static constexpr double move_overhead_ms = 30;
+
+  time_manager() : t0(now()), soft_ms(-1), hard_ms(-1), next_poll(0), adaptive(false),
+    optimum_ms(-1), instability(0), last_iteration_ms(0), prev_iteration_time(0), iterations(0),
+    last_eval(0), last_best{} { }
+  time_manager(const time_manager& o) = delete;
+  time_manager(const time_manager&& o) = delete;
+  time_manager& operator=(const time_manager& o) = delete;
+  time_manager& operator=(const time_manager&& o) = delete;
+  ~time_manager() = default;
+
+  // (re)starts the clock, safe to call while the master is polling
+  void start(const double& soft, const double& hard) {
+    t0 = now();
+    soft_ms = soft;
+    hard_ms = hard;
+    adaptive = false;
+    optimum_ms = soft;
+  }
+
+  // budget from the side to move's clock.  the optimum spreads what is left
+  // over an estimate of the moves remaining (fewer once material comes off),
+  // the maximum caps a single move so one hard position cannot flag the clock
+  void start(const double& remaining, const double& inc, const unsigned& movestogo, const unsigned& men) {
+    const double usable = std::max(remaining - move_overhead_ms, 1.0);
+    const double mtg = (movestogo > 0 ? std::min(movestogo, 50u) : 20.0 + 25.0 * std::min(men, 32u) / 32.0);
+    const double cap = usable * (movestogo == 1 ? 0.9 : 0.6);
+    const double optimum = std::min(usable / mtg + 0.75 * inc, cap);
+    const double maximum = std::min(5.0 * optimum, cap);
+
+    start(optimum, maximum);
+    adaptive = true;
+  }
+
+  // before each search, while no thread is polling
+  void reset() {
+    next_poll = 0;
+    instability = 0;
+    last_iteration_ms = 0;
+    prev_iteration_time = 0;
+    iterations = 0;
+    last_eval = 0;
+    last_best = {};
+  }
+
+  double elapsed_ms() const { return (now() - t0) / 1000.0; }
+  double soft_limit() const { return soft_ms; }
+  double hard_limit() const { return hard_ms; }
+  bool limited() const { return hard_ms >= 0; }
+  bool soft_expired() const { return soft_ms >= 0 && elapsed_ms() >= soft_ms; }
+  bool hard_expired() const { return hard_ms >= 0 && elapsed_ms() >= hard_ms; }
+
+  // master thread only, called after each completed iteration with the root
+  // best move, its score, the aspiration fail-lows it took and the fraction of
+  // root nodes spent below the best move.  rescales the soft deadline and
+  // returns true when the next iteration should not be started: either the
+  // soft deadline passed or the predicted iteration would run into the hard one
+  bool update(const Move& best, const int& eval, const unsigned& fail_lows, const double& best_fraction) {
+    const double elapsed = elapsed_ms();
+    const double iteration_ms = std::max(elapsed - last_iteration_ms, 0.0); // a ponderhit restarts t0
+    last_iteration_ms = elapsed;
+
+    if (!adaptive) {
+      ++iterations;
+      return soft_expired();
+    }
+
+    // best move changes add to an instability that halves each iteration
+    instability *= 0.5;
+    if (iterations > 0 && best != last_best) instability += 1.0;
+    const double stability = 0.75 + 0.6 * instability;
+
+    // a falling score or failing low at the root asks for more time
+    const double drop = (iterations > 0 ? std::max(0, last_eval - eval) : 0);
+    const double falling = std::min(1.0 + drop / 200.0 + 0.15 * fail_lows, 1.75);
+
+    // most of the tree below the best move means the alternatives are refuted quickly
+    const double effort = std::min(std::max(1.6 - best_fraction, 0.6), 1.5);
+
+    soft_ms = std::min(optimum_ms.load() * stability * falling * effort, hard_ms.load());
+
+    const double branching = (prev_iteration_time > 0 ? std::min(std::max(iteration_ms / prev_iteration_time, 1.5), 4.0) : 2.0);
+    prev_iteration_time = iteration_ms;
+    last_best = best;
+    last_eval = eval;
+    ++iterations;
+
+    return elapsed >= soft_ms || elapsed + branching * iteration_ms >= hard_ms;
+  }
+
+  // master thread only: reads the clock once per poll_nodes nodes
+  bool poll(const U64& nodes) {
+    if (nodes < next_poll) return false;
+    next_poll = nodes + poll_nodes;
+    return hard_expired();
+  }
+};
+
+// node limit shared by the search threads.  each thread reports its own count
+// (position::nodes) in batches of batch_nodes so the shared atomic is touched
+// rarely, but checks its unreported nodes on every call so a single threaded
+// search stops at the same node on every machine.  limit 0 = no limit
+class node_budget {
+  static const unsigned max_threads = 256;
+
+  std::atomic<U64> total;
+  U64 limit;
+  std::array<U64, max_threads> reported;
+
+ public:
+  static const U64 batch_nodes = 512;
+
+  node_budget() : total(0), limit(0), reported{} { }
+  node_budget(const node_budget& o) = delete;
+  node_budget(const node_budget&& o) = delete;
+  node_budget& operator=(const node_budget& o) = delete;
+  node_budget& operator=(const node_budget&& o) = delete;
+  ~node_budget() = default;
+
+  // before each search, while no thread is searching
+  void start(const U64& nodes) {
+    total = 0;
+    limit = nodes;
+    reported.fill(0);
+  }
+
+  bool limited() const { return limit > 0; }
+  U64 searched() const { return total; }
+
+  // true once the threads together searched the budget
+  bool exhausted(const unsigned& id, const U64& nodes) {
+    if (limit == 0) return false;
+    U64& r = reported[id % max_threads];
+    const U64 pending = nodes - r;
+    if (pending >= batch_nodes) {
+      r = nodes;
+      return total.fetch_add(pending, std::memory_order_relaxed) + pending >= limit;
+    }
+    return total.load(std::memory_order_relaxed) + pending >= limit;
+  }
+};
+
+#endif
@@ -0,0 +1,159 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of the Havoc chess engine
+Copyright (c) 2020 Minniesoft
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <fstream>
+
+#include "types.h"
+
+// timeline of search activity in chrome trace-event format, opens in perfetto
+// or chrome://tracing.  every thread that records gets its own ring buffer
+// on first use, after that recording is a relaxed load when tracing is off
+// and a few stores when on: no locks, no allocation.  a full ring overwrites
+// its oldest events.  names and arg keys must be string literals
+namespace trace {
+
+  struct event {
+    const char * name;
+    const char * keys[2];
+    int values[2];
+    long long ts;  // us since the trace clock started
+    char phase;    // 'B' begin, 'E' end, 'i' instant
+  };
+
+  struct ring {
+    static const unsigned size = 1 << 14;
+    std::array<event, size> events;
+    std::atomic<U64> head;
+    unsigned tid;
+
+    ring(unsigned id) : events(), head(0), tid(id) { }
+
+    void push(const event& e) { // owning thread only
+      const U64 h = head.load(std::memory_order_relaxed);
+      events[h & (size - 1)] = e;
+      head.store(h + 1, std::memory_order_release);
+    }
+  };
+
+  inline std::atomic<bool>& enabled() { static std::atomic<bool> on(false); return on; }
+  inline std::mutex& registry_mutex() { static std::mutex m; return m; }
+  inline std::vector<std::unique_ptr<ring>>& rings() { static std::vector<std::unique_ptr<ring>> r; return r; }
+
+  inline long long now_us() {
+    typedef std::chrono::steady_clock clock;
+    static const clock::time_point t0 = clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - t0).count();
+  }
+
+  inline ring& local() {
+    thread_local ring * r = nullptr;
+    if (!r) {
+      std::unique_lock<std::mutex> lock(registry_mutex());
+      rings().emplace_back(new ring(static_cast<unsigned>(rings().size())));
+      r = rings().back().get();
+    }
+    return *r;
+  }
+
+  inline void record(const char phase, const char * name,
+		     const char * k0 = nullptr, const int v0 = 0, const char * k1 = nullptr, const int v1 = 0) {
+    if (!enabled().load(std::memory_order_relaxed)) return;
+    event e;
+    e.name = name;
+    e.keys[0] = k0;
+    e.keys[1] = k1;
+    e.values[0] = v0;
+    e.values[1] = v1;
+    e.ts = now_us();
+    e.phase = phase;
+    local().push(e);
+  }
+
+  inline void instant(const char * name, const char * k0 = nullptr, const int v0 = 0, const char * k1 = nullptr, const int v1 = 0) {
+    record('i', name, k0, v0, k1, v1);
+  }
+
+  // begin/end pair for the enclosing block
+  struct scope {
+    const char * name;
+    scope(const char * n, const char * k0 = nullptr, const int v0 = 0, const char * k1 = nullptr, const int v1 = 0) : name(n) {
+      record('B', name, k0, v0, k1, v1);
+    }
+    ~scope() { record('E', name); }
+    scope(const scope& o) = delete;
+    scope& operator=(const scope& o) = delete;
+  };
+
+  // drops whatever was recorded and starts recording.  call while no search runs
+  inline void start() {
+    std::unique_lock<std::mutex> lock(registry_mutex());
+    for (auto& r : rings()) r->head = 0;
+    enabled() = true;
+  }
+
+  // stops recording and writes the trace.  call while no search runs
+  inline bool stop(const std::string& filename) {
+    enabled() = false;
+    std::ofstream out(filename);
+    if (!out.is_open()) return false;
+
+    std::unique_lock<std::mutex> lock(registry_mutex());
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (auto& r : rings()) {
+      out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << r->tid
+	  << ",\"args\":{\"name\":\"thread " << r->tid << "\"}}";
+      first = false;
+
+      const U64 head = r->head.load(std::memory_order_acquire);
+      const U64 tail = head > ring::size ? head - ring::size : 0;
+      for (U64 i = tail; i < head; ++i) {
+	const event& e = r->events[i & (ring::size - 1)];
+	out << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"" << e.phase << "\",\"ts\":" << e.ts
+	    << ",\"pid\":1,\"tid\":" << r->tid;
+	if (e.phase == 'i') out << ",\"s\":\"t\"";
+	if (e.keys[0]) {
+	  out << ",\"args\":{\"" << e.keys[0] << "\":" << e.values[0];
+	  if (e.keys[1]) out << ",\"" << e.keys[1] << "\":" << e.values[1];
+	  out << "}";
+	}
+	out << "}";
+      }
+    }
+    out << "\n]}\n";
+    return true;
+  }
+}
+
+#endif
@@ -0,0 +1,163 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of the Havoc chess engine
+Copyright (c) 2020 Minniesoft
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#ifndef TREELOG_H
+#define TREELOG_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <mutex>
+#include <algorithm>
+
+#include "types.h"
+
+// search tree log.  with 'treelog on' every search thread appends fixed size
+// records to its own buffer: one per node entered, one per node result and
+// one per pruning decision, up to a record budget and a maximum ply.  buffers
+// are reserved up front, so a logged node costs a branch and a store, and an
+// unlogged search only the branch.  after each search the buffers are appended
+// to the log file as one block, 'treestat' reads the file back
+
+enum tree_event : U8 {
+  tree_node,        // search node entered: window, depth, move that led here
+  tree_qnode,       // qsearch node entered
+  tree_result,      // search node done: score, best move
+  tree_tt_cut,
+  tree_futility,
+  tree_razor,
+  tree_null_cut,
+  tree_multicut,
+  tree_see_prune,   // move skipped, move is the pruned one
+  tree_qtt_cut,
+  tree_stand_pat,
+  tree_delta_prune,
+  tree_qsee_prune,
+  tree_events
+};
+
+static const char * const tree_event_names[tree_events] = {
+  "node", "qnode", "result", "tt cut", "futility", "razor", "null cut",
+  "multicut", "see prune", "qs tt cut", "stand pat", "delta prune", "qs see prune"
+};
+
+struct tree_record {
+  U64 key;
+  int16 alpha;
+  int16 beta;
+  int16 score;
+  U8 from, to, mtype;
+  U8 depth;
+  U8 ply;
+  U8 event;
+  U8 reserved[2];
+};
+static_assert(sizeof(tree_record) == 24, "tree_record is written to disk as is");
+
+// one search thread's records
+struct tree_log {
+  std::vector<tree_record> records;
+  size_t max_records = 0;
+  unsigned max_ply = 0;
+  U64 dropped = 0;
+
+  void reset(const size_t& budget, const unsigned& ply_limit) {
+    records.clear();
+    records.reserve(budget);
+    max_records = budget;
+    max_ply = ply_limit;
+    dropped = 0;
+  }
+
+  void add(const U64& key, const tree_event& ev, const unsigned& ply, const int& depth,
+	   const int& alpha, const int& beta, const int& score, const Move& m) {
+    if (ply > max_ply) return;
+    if (records.size() >= max_records) { ++dropped; return; }
+    tree_record r;
+    r.key = key;
+    r.alpha = static_cast<int16>(alpha);
+    r.beta = static_cast<int16>(beta);
+    r.score = static_cast<int16>(score);
+    r.from = m.f;
+    r.to = m.t;
+    r.mtype = m.type;
+    r.depth = static_cast<U8>(std::max(0, std::min(depth, 255)));
+    r.ply = static_cast<U8>(ply);
+    r.event = ev;
+    r.reserved[0] = r.reserved[1] = 0;
+    records.push_back(r);
+  }
+};
+
+namespace treelog {
+
+  static const char magic[8] = { 'h', 'v', 't', 'r', 'e', 'e', '1', 0 };
+
+  struct settings {
+    bool on = false;
+    std::string file;
+    size_t max_records = 0;  // per thread and search
+    unsigned max_ply = 0;
+    unsigned searches = 0;   // blocks written since 'treelog on'
+  };
+
+  inline settings& config() { static settings s; return s; }
+
+  // truncates the log file and logs every following search
+  inline bool start(const std::string& file, const size_t& max_records, const unsigned& max_ply) {
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+    settings& s = config();
+    s.file = file;
+    s.max_records = max_records;
+    s.max_ply = max_ply;
+    s.searches = 0;
+    s.on = true;
+    return true;
+  }
+
+  inline void stop() { config().on = false; }
+
+  // block: magic, search number, thread count, then per thread its id, record
+  // count, dropped count and records.  callers serialize
+  inline void append(const std::vector<const tree_log*>& logs) {
+    settings& s = config();
+    std::ofstream out(s.file, std::ios::binary | std::ios::app);
+    if (!out.is_open()) return;
+    const U32 search = s.searches++, threads = static_cast<U32>(logs.size());
+    out.write(magic, sizeof(magic));
+    out.write(reinterpret_cast<const char*>(&search), sizeof(search));
+    out.write(reinterpret_cast<const char*>(&threads), sizeof(threads));
+    for (U32 t = 0; t < threads; ++t) {
+      const U64 count = logs[t]->records.size(), dropped = logs[t]->dropped;
+      out.write(reinterpret_cast<const char*>(&t), sizeof(t));
+      out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+      out.write(reinterpret_cast<const char*>(&dropped), sizeof(dropped));
+      out.write(reinterpret_cast<const char*>(logs[t]->records.data()), count * sizeof(tree_record));
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,220 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of the Havoc chess engine
+Copyright (c) 2020 Minniesoft
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#ifndef TREESTAT_H
+#define TREESTAT_H
+
+#include <map>
+#include <array>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+
+#include "types.h"
+#include "treelog.h"
+#include "uci.h"
+
+// reads a treelog file back and answers where the nodes went: which pruning
+// rule fired at which remaining depth, how the node count grows with ply and
+// which subtrees near the root took the most nodes
+namespace treestat {
+
+  typedef std::array<U64, tree_events> event_counts;
+
+  struct subtree {
+    U64 size;
+    U32 search;
+    U32 thread;
+    tree_record root;
+    std::string path;
+  };
+
+  struct summary {
+    U32 searches = 0;
+    U64 records = 0;
+    U64 dropped = 0;
+    event_counts totals{};
+    std::map<unsigned, event_counts> by_depth; // search nodes, by remaining depth
+    std::map<unsigned, std::array<U64, 2>> by_ply; // search nodes, qsearch nodes
+    std::vector<subtree> largest;
+  };
+
+  static const unsigned subtree_max_ply = 3; // root is ply 1
+  static const size_t subtree_count = 12;
+
+  inline std::string move_string(const tree_record& r) {
+    if (r.from == r.to) return "0000";
+    Move m{};
+    m.set(r.from, r.to, static_cast<Movetype>(r.mtype));
+    return uci::move_to_string(m);
+  }
+
+  inline void keep_largest(summary& s, const subtree& t) {
+    s.largest.push_back(t);
+    std::sort(s.largest.begin(), s.largest.end(), [](const subtree& a, const subtree& b) { return a.size > b.size; });
+    if (s.largest.size() > subtree_count) s.largest.pop_back();
+  }
+
+  // one thread's records of one search, in search (depth first) order.  a
+  // node's subtree is every node record after it up to the next one at the
+  // same or a lower ply
+  inline void scan(summary& s, const std::vector<tree_record>& records, const U32& search, const U32& thread) {
+    struct open_node { tree_record r; U64 start; std::string path; };
+    std::vector<open_node> open;
+    U64 nodes = 0;
+
+    auto close = [&](const open_node& o) {
+      if (o.r.ply >= 2) keep_largest(s, subtree{ nodes - o.start, search, thread, o.r, o.path });
+    };
+
+    for (const tree_record& r : records) {
+      ++s.totals[r.event];
+      if (r.event != tree_node && r.event != tree_qnode) {
+	if (r.event != tree_result && r.event < tree_qtt_cut) ++s.by_depth[r.depth][r.event];
+	continue;
+      }
+
+      if (r.event == tree_node) {
+	++s.by_depth[r.depth][tree_node];
+	++s.by_ply[r.ply][0];
+      }
+      else ++s.by_ply[r.ply][1];
+
+      while (!open.empty() && open.back().r.ply >= r.ply) { close(open.back()); open.pop_back(); }
+      if (r.event == tree_node && r.ply <= subtree_max_ply) {
+	const std::string path = (open.empty() ? std::string() : open.back().path + " ") + move_string(r);
+	open.push_back(open_node{ r, nodes, r.ply <= 1 ? std::string() : path });
+      }
+      ++nodes;
+    }
+    while (!open.empty()) { close(open.back()); open.pop_back(); }
+  }
+
+  inline bool load(const std::string& file, summary& s) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in.is_open()) return false;
+
+    char magic[sizeof(treelog::magic)];
+    while (in.read(magic, sizeof(magic))) {
+      if (std::memcmp(magic, treelog::magic, sizeof(magic)) != 0) return false;
+      U32 search = 0, threads = 0;
+      in.read(reinterpret_cast<char*>(&search), sizeof(search));
+      in.read(reinterpret_cast<char*>(&threads), sizeof(threads));
+      ++s.searches;
+
+      for (U32 t = 0; t < threads && in; ++t) {
+	U32 thread = 0;
+	U64 count = 0, dropped = 0;
+	in.read(reinterpret_cast<char*>(&thread), sizeof(thread));
+	in.read(reinterpret_cast<char*>(&count), sizeof(count));
+	in.read(reinterpret_cast<char*>(&dropped), sizeof(dropped));
+	std::vector<tree_record> records(count);
+	in.read(reinterpret_cast<char*>(records.data()), count * sizeof(tree_record));
+	if (!in) return false;
+
+	s.records += count;
+	s.dropped += dropped;
+	scan(s, records, search, thread);
+      }
+    }
+    return true;
+  }
+
+  // treestat <file> [depth]: the whole summary, or the pruning at one depth
+  inline void run(const std::string& file, const int& depth) {
+    summary s;
+    if (!load(file, s)) {
+      std::cout << "cannot read tree log " << file << std::endl;
+      return;
+    }
+
+    std::cout << s.searches << " searches, " << s.records << " records";
+    if (s.dropped) std::cout << ", " << s.dropped << " dropped past the record budget";
+    std::cout << std::endl;
+
+    const tree_event prunes[] = { tree_tt_cut, tree_futility, tree_razor, tree_null_cut, tree_multicut, tree_see_prune };
+
+    if (depth >= 0) {
+      const event_counts& c = s.by_depth[depth];
+      std::vector<tree_event> order(std::begin(prunes), std::end(prunes));
+      std::sort(order.begin(), order.end(), [&](tree_event a, tree_event b) { return c[a] > c[b]; });
+      std::cout << "depth " << depth << ": " << c[tree_node] << " nodes" << std::endl;
+      for (const tree_event e : order) {
+	std::cout << "  " << std::left << std::setw(12) << tree_event_names[e] << std::right << std::setw(12) << c[e]
+		  << std::setw(8) << std::fixed << std::setprecision(1)
+		  << (c[tree_node] ? 100.0 * c[e] / c[tree_node] : 0.0) << " %" << std::endl;
+      }
+      std::cout.unsetf(std::ios_base::floatfield);
+      return;
+    }
+
+    std::cout << "\nevents" << std::endl;
+    for (unsigned e = 0; e < tree_events; ++e) {
+      std::cout << "  " << std::left << std::setw(14) << tree_event_names[e] << std::right << std::setw(14) << s.totals[e] << std::endl;
+    }
+
+    std::cout << "\nby remaining depth" << std::endl;
+    std::cout << std::setw(6) << "depth" << std::setw(11) << "nodes";
+    for (const tree_event e : prunes) std::cout << std::setw(11) << tree_event_names[e];
+    std::cout << "  most fired" << std::endl;
+    for (auto it = s.by_depth.rbegin(); it != s.by_depth.rend(); ++it) {
+      const event_counts& c = it->second;
+      tree_event top = prunes[0];
+      for (const tree_event e : prunes) if (c[e] > c[top]) top = e;
+      std::cout << std::setw(6) << it->first << std::setw(11) << c[tree_node];
+      for (const tree_event e : prunes) std::cout << std::setw(11) << c[e];
+      std::cout << "  " << (c[top] ? tree_event_names[top] : "-") << std::endl;
+    }
+
+    std::cout << "\nby ply" << std::endl;
+    std::cout << std::setw(6) << "ply" << std::setw(12) << "nodes" << std::setw(12) << "qnodes" << std::setw(10) << "growth" << std::endl;
+    U64 previous = 0;
+    for (auto& b : s.by_ply) {
+      const U64 all = b.second[0] + b.second[1];
+      std::cout << std::setw(6) << b.first << std::setw(12) << b.second[0] << std::setw(12) << b.second[1]
+		<< std::setw(10) << std::fixed << std::setprecision(2) << (previous ? static_cast<double>(all) / previous : 0.0) << std::endl;
+      previous = all;
+    }
+    std::cout.unsetf(std::ios_base::floatfield);
+
+    const U64 all_nodes = s.totals[tree_node] + s.totals[tree_qnode];
+    std::cout << "\nlargest subtrees (ply 2-" << subtree_max_ply << ")" << std::endl;
+    for (const subtree& t : s.largest) {
+      std::cout << std::setw(10) << t.size << std::setw(7) << std::fixed << std::setprecision(1)
+		<< (all_nodes ? 100.0 * t.size / all_nodes : 0.0) << " %"
+		<< "  search " << t.search << " thread " << t.thread << " ply " << static_cast<int>(t.root.ply)
+		<< " depth " << static_cast<int>(t.root.depth)
+		<< " window [" << t.root.alpha << ", " << t.root.beta << "]"
+		<< " key " << std::hex << t.root.key << std::dec
+		<< "  " << t.path << std::endl;
+    }
+    std::cout.unsetf(std::ios_base::floatfield);
+  }
+}
+
+#endif
@@ -22,14 +22,24 @@ THE SOFTWARE.
 #include "uci.h"
 #include "move.h"
 #include "bench.h"
+#include "microbench.h"
 #include "search.h"
 #include "threads.h"
 #include "hashtable.h"
+#include "packed.h"
+#include "selfplay.h"
+#include "texel.h"
+#include "spsa.h"
+#include "match.h"
+#include "analyze.h"
+#include "treestat.h"
+#include "selftest.h"
 
 position p;
 Move dbgmove;
 Threadpool worker(1);
 signals UCI_SIGNALS;
+unsigned multipv = 1;
 
 void uci::loop() {
   p.params = eval::Parameters;
@@ -162,23 +172,194 @@ bool uci::parse_command(const std::string& input) {
       perft.divide(p, atoi(cmd.c_str()));
     }
     else if (cmd == "tune") {
+      // tune [epd file]
+      std::string epd_file;
+      if (!(instream >> epd_file)) epd_file = "tuning/epd/mini-test.txt";
       Perft perft;
-      perft.auto_tune();
+      perft.auto_tune(epd_file);
     }
-    else if (cmd == "bench" && instream >> cmd) {
+    else if (cmd == "bench") {
+      // bench [depth] [threads] [hash mb] [epd file]
+      int depth = 0;
+      unsigned threads = 0, hash_mb = 0;
+      std::string epd_file;
+      if (!(instream >> depth) || depth <= 0) depth = 12;
+      if (!(instream >> threads) || threads == 0) threads = 1;
+      if (!(instream >> hash_mb) || hash_mb == 0) hash_mb = 16;
+      instream >> epd_file;
       Perft perft;
-      int depth = atoi(cmd.c_str());
-      perft.bench(depth, true);
+      perft.bench(depth, threads, hash_mb, epd_file);
+    }
+    else if (cmd == "scalebench") {
+      // scalebench [max threads] [depth] [movetime ms] [hash mb] [json]
+      unsigned max_threads = 0, movetime = 0, hash_mb = 0;
+      int depth = 0;
+      std::string format;
+      if (!(instream >> max_threads) || max_threads == 0) max_threads = std::max(1u, std::thread::hardware_concurrency());
+      if (!(instream >> depth) || depth <= 0) depth = 10;
+      if (!(instream >> movetime) || movetime == 0) movetime = 200;
+      if (!(instream >> hash_mb) || hash_mb == 0) hash_mb = 16;
+      instream >> format;
+      Perft perft;
+      perft.scalebench(max_threads, depth, movetime, hash_mb, format == "json");
+    }
+    else if (cmd == "analyze") {
+      // analyze [depth n] [nodes n] [movetime ms] [workers n] [hash mb] [shared] [file <epd>] [out <file>]
+      // without a file, fen/epd lines follow on stdin up to a line "end"
+      analyze::settings s{};
+      memset(&s.lims, 0, sizeof(limits));
+      s.workers = std::max(1u, std::thread::hardware_concurrency());
+      s.hash_mb = 16;
+      while (instream >> cmd) {
+        if (cmd == "depth" && instream >> cmd) s.lims.depth = atoi(cmd.c_str());
+        else if (cmd == "nodes" && instream >> cmd) s.lims.nodes = atoi(cmd.c_str());
+        else if (cmd == "movetime" && instream >> cmd) s.lims.movetime = atoi(cmd.c_str());
+        else if (cmd == "workers" && instream >> cmd) s.workers = std::max(1, atoi(cmd.c_str()));
+        else if (cmd == "hash" && instream >> cmd) s.hash_mb = std::max(1, atoi(cmd.c_str()));
+        else if (cmd == "shared") s.shared = true;
+        else if (cmd == "file") instream >> s.in;
+        else if (cmd == "out") instream >> s.out;
+      }
+      if (!s.lims.depth && !s.lims.nodes && !s.lims.movetime) s.lims.depth = 10;
+      analyze::run(s);
+    }
+    else if (cmd == "microbench") {
+      // microbench [samples] [filter]
+      unsigned samples = 0;
+      std::string filter;
+      if (!(instream >> samples) || samples == 0) samples = 15;
+      instream >> filter;
+      microbench::run(samples, filter);
+    }
+    else if (cmd == "pack" && instream >> cmd) {
+      // pack pgn <out> <in.pgn> [in2.pgn ..] | pack epd <in.epd> <out>
+      std::string a, b;
+      if (cmd == "pgn" && instream >> a) {
+        std::vector<std::string> files;
+        while (instream >> b) files.push_back(b);
+        packed::from_pgn(files, a);
+      }
+      else if (cmd == "epd" && instream >> a >> b) packed::from_epd(a, b);
+      else std::cout << "usage: pack pgn <out> <in.pgn ..> | pack epd <in.epd> <out>" << std::endl;
+    }
+    else if (cmd == "selfplay") {
+      // selfplay <games> <depth> <out>
+      unsigned games = 0, depth = 0;
+      std::string out;
+      if (instream >> games >> depth >> out) selfplay::generate(games, depth, out);
+      else std::cout << "usage: selfplay <games> <depth> <out>" << std::endl;
+    }
+    else if (cmd == "packinfo" && instream >> cmd) {
+      packed_file f(cmd);
+      unsigned n = 0;
+      if (!(instream >> n)) n = 5;
+      std::cout << cmd << ": " << f.size() << " positions" << std::endl;
+      f.shuffle(static_cast<U64>(time(nullptr)));
+      for (size_t i = 0; i < f.size() && i < n; ++i) {
+        position tmp;
+        tmp.setup(f.at(i));
+        std::cout << tmp.to_fen() << " result " << static_cast<int>(f.at(i).result)
+          << " score " << (f.at(i).has_score() ? f.at(i).score : 0) << std::endl;
+      }
+    }
+    else if (cmd == "texel" && instream >> cmd) {
+      // texel <packed file> [iterations] [threads] [param file]
+      unsigned iterations = 0, threads = 0;
+      std::string param_file;
+      if (!(instream >> iterations)) iterations = 100;
+      if (!(instream >> threads)) threads = std::thread::hardware_concurrency();
+      instream >> param_file;
+      tuning::texel_tune(cmd, iterations, threads, param_file);
+      p.params = eval::Parameters;
+    }
+    else if (cmd == "spsa") {
+      // spsa [iterations] [pairs] [depth] [threads] [param file]
+      spsa::settings s;
+      std::string param_file;
+      unsigned v = 0;
+      s.threads = std::max(1u, std::thread::hardware_concurrency());
+      if (instream >> v) s.iterations = v;
+      if (instream >> v) s.pairs = v;
+      if (instream >> v) s.depth = v;
+      if (instream >> v) s.threads = v;
+      instream >> param_file;
+      spsa::run(s, param_file);
+      p.params = eval::Parameters;
+    }
+    else if (cmd == "match") {
+      // match <conf a|current> <conf b|current> [games] [depth] [threads] [openings epd/pgn]
+      match::settings s;
+      std::string conf_a, conf_b, openings;
+      unsigned v = 0;
+      s.threads = std::max(1u, std::thread::hardware_concurrency());
+      if (!(instream >> conf_a >> conf_b)) {
+        std::cout << "usage: match <conf a|current> <conf b|current> [games] [depth] [threads] [openings]" << std::endl;
+        continue;
+      }
+      if (instream >> v) s.games = v;
+      if (instream >> v) s.depth = v;
+      if (instream >> v) s.threads = v;
+      instream >> openings;
+
+      parameters a = eval::Parameters, b = eval::Parameters;
+      if ((conf_a == "current" || match::load_params(conf_a, a)) &&
+          (conf_b == "current" || match::load_params(conf_b, b))) {
+        match::run(a, b, s, openings.empty() ? std::vector<std::string>{} : match::load_openings(openings, s.opening_plies));
+      }
     }
     else if (cmd == "debug") {
       p.debug_search = !p.debug_search;
       std::cout << "debugging set to: " << p.debug_search << std::endl;
     }
+    else if (cmd == "trace" && instream >> cmd) {
+      // trace on | trace off [file]: chrome trace-event json of the searches in between
+      if (cmd == "on") {
+        trace::start();
+        std::cout << "tracing on" << std::endl;
+      }
+      else if (cmd == "off") {
+        std::string file = "trace.json";
+        instream >> file;
+        if (trace::stop(file)) std::cout << "trace written to " << file << std::endl;
+        else std::cout << "could not write " << file << std::endl;
+      }
+    }
+    else if (cmd == "treelog" && instream >> cmd) {
+      // treelog on [file] [records per thread] [max ply] | treelog off
+      if (cmd == "on") {
+        std::string file = "tree.bin";
+        size_t max_records = 1000000;
+        unsigned max_ply = 64;
+        instream >> file >> max_records >> max_ply;
+        if (treelog::start(file, max_records, std::min(max_ply, 255u))) std::cout << "logging search trees to " << file << std::endl;
+        else std::cout << "could not write " << file << std::endl;
+      }
+      else if (cmd == "off") {
+        treelog::stop();
+        std::cout << treelog::config().searches << " searches logged to " << treelog::config().file << std::endl;
+      }
+    }
+    else if (cmd == "treestat" && instream >> cmd) {
+      // treestat <file> [depth]
+      int depth = -1;
+      instream >> depth;
+      treestat::run(cmd, depth);
+    }
+    else if (cmd == "selftest") {
+      selftest::run();
+    }
+    else if (cmd == "stats") {
+#ifdef SEARCH_STATS
+      std::cout << Search::last_stats.to_json() << std::endl;
+#else
+      std::cout << "{\"enabled\":false}" << std::endl;
+#endif
+    }
 
 
     // game specific uci commands (refactor?)
-    else if (cmd == "isready") {	
-      ttable.clear();
+    else if (cmd == "isready") {
+      // keep the table: after a ponder miss the next search reuses it
       std::cout << "readyok" << std::endl;
     }
     else if (!Search::searching && cmd == "go") {           
@@ -197,13 +378,21 @@ bool uci::parse_command(const std::string& input) {
         else if (cmd == "mate" && instream >> cmd) lims.mate = atoi(cmd.c_str());
         else if (cmd == "depth" && instream >> cmd) lims.depth = atoi(cmd.c_str());
         else if (cmd == "infinite") lims.infinite = (cmd == "infinite" ? true : false);
-        else if (cmd == "ponder") lims.ponder = atoi(cmd.c_str());
+        else if (cmd == "ponder") lims.ponder = true;
       }
-      bool silent = false;
-      worker.enqueue(Search::start, p, lims, silent);
+      lims.multipv = multipv;
+      // the limits are copied into the task, the search outlives this scope
+      UCI_SIGNALS.reset(lims.ponder);
+      worker.enqueue([lims]() mutable { Search::start(p, lims, false); });
     }
     else if (cmd == "stop") {
       UCI_SIGNALS.stop = true;
+      UCI_SIGNALS.notify();
+    }
+    else if (cmd == "ponderhit") {
+      // the expected reply was played: the ponder search continues on the clock
+      UCI_SIGNALS.ponder_hit = true;
+      UCI_SIGNALS.notify();
     }
     else if (cmd == "moves") {
       Movegen mvs(p);
@@ -214,12 +403,24 @@ bool uci::parse_command(const std::string& input) {
       }
       std::cout << std::endl;
     }
+    else if (cmd == "setoption") {
+      // setoption name <id> value <x>
+      std::string token, name, value;
+      while (instream >> token && token != "value") {
+        if (token != "name") name += (name.empty() ? "" : " ") + token;
+      }
+      instream >> value;
+      std::transform(name.begin(), name.end(), name.begin(), tolower);
+      if (name == "multipv") multipv = std::min(std::max(atoi(value.c_str()), 1), 64);
+      else std::cout << "unknown option: " << name << std::endl;
+    }
     else if (cmd == "ucinewgame") {      
       ttable.clear();      
     }
     else if (cmd == "uci") {
       ttable.clear();
       std::cout << "id name haVoc" << std::endl;
+      std::cout << "option name MultiPV type spin default 1 min 1 max 64" << std::endl;
       std::cout << "uciok" << std::endl;
     }
     
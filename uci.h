@@ -29,9 +29,12 @@ THE SOFTWARE.
 #include <cstdio>
 #include <algorithm>
 #include <string>
+#include <mutex>
+#include <condition_variable>
 
 #include "bits.h"
 #include "types.h"
+#include "timeman.h"
 
 struct Move;
 
@@ -40,11 +43,33 @@ const std::string START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQk
 struct limits {
   unsigned wtime, btime, winc, binc;
   unsigned movestogo, nodes, movetime, mate, depth;
+  unsigned multipv;
+  unsigned threads; // 0 or 1 searches on the master alone
   bool infinite, ponder;
 };
 
 struct signals {
-  volatile bool stop, ponder_hit, times_up;
+  volatile bool stop, ponder_hit, times_up, pondering;
+  time_manager timer;
+  node_budget budget;
+  std::mutex m;
+  std::condition_variable cv;
+
+  // arms the flags for the next search.  callers do this before handing the
+  // search to another thread: Search::start only reads them, so a ponderhit
+  // or stop sent right after go is not lost
+  void reset(const bool& ponder) {
+    stop = false;
+    ponder_hit = false;
+    times_up = false;
+    pondering = ponder;
+  }
+
+  // wakes Search::start, which sleeps until the search ends or a ponderhit
+  void notify() {
+    std::unique_lock<std::mutex> lock(m);
+    cv.notify_all();
+  }
 };
 
 namespace uci {
@@ -52,6 +52,23 @@ namespace util {
     return tokens;
   }
 
+  // the fen in a fen or epd line: board, side, castling and ep fields plus the
+  // two counters when present.  epd operations (bm, id, ..) are dropped, empty
+  // when the line has fewer than four fields
+  inline std::string fen_from_epd(const std::string& line) {
+    std::istringstream tokens(line.substr(0, line.find(';')));
+    std::vector<std::string> fields;
+    std::string t;
+    while (tokens >> t && fields.size() < 6) {
+      if (fields.size() >= 4 && t.find_first_not_of("0123456789") != std::string::npos) break;
+      fields.push_back(t);
+    }
+    if (fields.size() < 4) return std::string();
+    std::string fen = fields[0];
+    for (size_t i = 1; i < fields.size(); ++i) fen += " " + fields[i];
+    return fen;
+  }
+
 
   inline int row(const int& r) { return (r >> 3); }
   inline int col(const int& c) { return c & 7; }